@@ -0,0 +1,122 @@
+#!/bin/bash
+
+# Benchmark of the Game of Life: generates synthetic boards (by the generator of life, without board files), runs them over a matrix of sizes, numbers of processes
+# and generations, and reports cell updates per second, strong and weak scaling efficiency and halo bandwidth.
+# Results are printed and written to bench_output.txt. The matrix can be changed by the environment variables below.
+#
+# Usage: ./bench.sh [options of life]
+# Example: SIZES="1024 2048" RANKS="1 2 4" ./bench.sh --kernel lookup
+
+sizes=${SIZES:-"512 1024 2048"} # Number of rows and columns of the square boards (strong scaling)
+ranks=${RANKS:-"1 2 4"} # Numbers of processes (all of them compute the board, see --processes)
+generations=${GENERATIONS:-"10 100"} # Numbers of generations
+patterns=${PATTERNS:-"random:0.1 random:0.35 random:0.6 guns empty"} # Boards (random fill with the density, glider guns, empty board)
+weak_rows=${WEAK_ROWS:-512} # Rows per process of the weak scaling boards
+seed=${SEED:-1} # Seed of the random boards, the same seed gives the same boards
+mpirun_flags=${MPIRUN_FLAGS:-"--prefix /usr/local/share/OpenMPI --use-hwthread-cpus"}
+output=bench_output.txt
+
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+# Write the 64x64 tile with a Gosper glider gun (36x9) into $work_dir/gun.txt, it is repeated over the guns boards
+awk '
+BEGIN {
+    gun[0] = "........................O..........."
+    gun[1] = "......................O.O..........."
+    gun[2] = "............OO......OO............OO"
+    gun[3] = "...........O...O....OO............OO"
+    gun[4] = "OO........O.....O...OO.............."
+    gun[5] = "OO........O...O.OO....O.O..........."
+    gun[6] = "..........O.....O.......O..........."
+    gun[7] = "...........O...O...................."
+    gun[8] = "............OO......................"
+    for (i = 0; i < 64; i++) {
+        line = ""
+        for (j = 0; j < 64; j++) {
+            x = i - 8; y = j - 8
+            line = line ((x >= 0 && x < 9 && y >= 0 && y < 36 && substr(gun[x], y + 1, 1) == "O") ? 1 : 0)
+        }
+        print line
+    }
+}' > "$work_dir/gun.txt"
+
+# Print the option of life generating the board, so no board file is written or read: board_option <pattern> <rows> <columns>
+board_option() {
+    case "$1" in
+        random:*) echo "--generate random:$3x$2:${1#random:}:$seed" ;;
+        guns) echo "--generate tile:$3x$2:$work_dir/gun.txt" ;;
+        *) echo "--generate random:$3x$2:0:$seed" ;;
+    esac
+}
+
+# Run life with the profiler: run_life <processes> <board option> <generations>
+# The profile of the last run is kept in $work_dir/profile.json.
+run_life() {
+    mpirun $mpirun_flags -np "$1" ./life $2 "$3" --profile --processes all "${extra_args[@]}" > /dev/null 2> "$work_dir/profile.json"
+}
+
+# Print a time of the last profile: profile_value <name> <min|mean|max>
+profile_value() {
+    grep "\"$1\"" "$work_dir/profile.json" | head -1 | sed "s/.*\"$2\": \([0-9.e+-]*\).*/\1/"
+}
+
+# Print the mean of the halo bytes sent by a process in the last profile
+profile_bytes() {
+    grep -A1 '"bytes"' "$work_dir/profile.json" | tail -1 | sed 's/.*"mean": \([0-9.e+-]*\).*/\1/'
+}
+
+extra_args=("$@") # Options passed to life
+
+# Compile the C++ code
+mpic++ --prefix /usr/local/share/OpenMPI -O3 -pthread -o life life.cpp || exit 1
+
+printf "%-8s %-14s %7s %5s %6s %10s %14s %12s %10s\n" scaling pattern rows ranks gens seconds cell_updates/s halo_MB/s efficiency | tee "$output"
+
+for pattern in $patterns; do
+    for gens in $generations; do
+        # Strong scaling, the same board on more processes
+        for size in $sizes; do
+            board=$(board_option "$pattern" "$size" "$size")
+            base=""
+            for np in $ranks; do
+                run_life "$np" "$board" "$gens" || continue
+                seconds=$(profile_value loop max)
+                halo_seconds=$(profile_value halo max)
+                halo_bytes=$(profile_bytes)
+                [ -z "$base" ] && base=$seconds && base_np=$np
+                awk -v s="$seconds" -v hs="$halo_seconds" -v hb="$halo_bytes" -v np="$np" -v base="$base" -v base_np="$base_np" \
+                    -v cells="$((size * size))" -v gens="$gens" -v pattern="$pattern" -v rows="$size" '
+                    BEGIN {
+                        rate = s > 0 ? cells * gens / s : 0
+                        bandwidth = hs > 0 ? hb * np / hs / 1e6 : 0
+                        efficiency = s > 0 ? base * base_np / (s * np) : 0
+                        printf "%-8s %-14s %7d %5d %6d %10.4f %14.4g %12.2f %10.3f\n", "strong", pattern, rows, np, gens, s, rate, bandwidth, efficiency
+                    }'
+            done
+        done | tee -a "$output"
+
+        # Weak scaling, the same number of rows per process
+        base=""
+        for np in $ranks; do
+            rows=$((weak_rows * np))
+            board=$(board_option "$pattern" "$rows" "$weak_rows")
+            run_life "$np" "$board" "$gens" || continue
+            seconds=$(profile_value loop max)
+            halo_seconds=$(profile_value halo max)
+            halo_bytes=$(profile_bytes)
+            [ -z "$base" ] && base=$seconds
+            awk -v s="$seconds" -v hs="$halo_seconds" -v hb="$halo_bytes" -v np="$np" -v base="$base" \
+                -v cells="$((rows * weak_rows))" -v gens="$gens" -v pattern="$pattern" -v rows="$rows" '
+                BEGIN {
+                    rate = s > 0 ? cells * gens / s : 0
+                    bandwidth = hs > 0 ? hb * np / hs / 1e6 : 0
+                    efficiency = s > 0 ? base / s : 0
+                    printf "%-8s %-14s %7d %5d %6d %10.4f %14.4g %12.2f %10.3f\n", "weak", pattern, rows, np, gens, s, rate, bandwidth, efficiency
+                }'
+        done | tee -a "$output"
+    done
+done
+
+# Clean up
+rm -f life
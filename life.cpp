@@ -3,9 +3,14 @@
  * @author Bc. Martin Baláž
  * @date 25.4.2024
  * @brief This file implements Game of Life (no-person game) using library OpenMPI.
- *        It is implemented using solid walls, so the cells on the edges are not affected by the cells outside the board.
- *        The board is divided into slices (2 lines or more), each slice is processed by one processor. All slices have same size.
- *        Program works correctly only for even number of lines and columns.
+ *        Any Life-like rule in B/S notation can be simulated, Conway's rule (B3/S23) is the default.
+ *        It is implemented using solid walls, so the cells on the edges are not affected by the cells outside the board,
+ *        or as a torus, where the rows and columns on the edges are neighbours of the rows and columns on the other side.
+ *        The board is divided into slices of rows, each slice is processed by one processor. The slices differ by at most one row,
+ *        and the number of processors computing them is chosen by a cost model (processors above the number of rows stay idle).
+ *        Each slice keeps several ghost rows of its neighbours, so that it can be advanced several generations per halo exchange
+ *        (temporal blocking), and the rows are processed in cache sized tiles skewed in time.
+ *        Boards of any number of rows and columns are supported.
  * @note The program will not work for extremely large boards!!
  */
 
@@ -14,239 +19,2899 @@
 #include <string>
 #include <fstream>
 #include <cstdlib>
+#include <cstdint>
 #include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <map>
+#include <array>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sched.h>
 
 using namespace std;
 
+typedef uint8_t Cell; // State of one cell (0 = dead, 1 = alive), one byte so that a tile of rows fits in the cache
+
 // Constants
 const int MASTER = 0; // Rank of the root process
-const int TAG = 0; // Tag for messages (not needed)
+const int ROWS = 0; // Index of the number of rows in the broadcast dimensions of the board
+const int COLUMNS = 1; // Index of the number of columns in the broadcast dimensions of the board
+
+const int DEFAULT_DEPTH = 4; // Default number of generations computed per halo exchange
+const int LOOKUP_WIDTH = 2; // Number of cells in a row computed by one lookup of the table kernel
+const long DEFAULT_L2_BYTES = 256 * 1024; // L2 cache size used when the system does not report it
+const int MAX_NEIGHBOURS = 8; // Number of neighbours of a cell (highest digit of the B/S notation)
+const size_t OUTPUT_BUFFER = 1 << 20; // Size of the output buffer written by one call
+const int SOUP_SIZE = 16; // Number of rows and columns of a random soup of the census
+const int CENSUS_BOARD = 64; // Number of rows and columns of the board with walls, the soup is in its centre
+const int MAX_PERIOD = 30; // Longest period of a stabilised board detected by the census
+const double CELL_SECONDS = 1e-9; // Time of one cell update in the cost model of the number of processes
+const double LATENCY_SECONDS = 5e-6; // Latency of one halo message in the cost model
+const double BYTE_SECONDS = 1e-9; // Time of one byte of a halo message in the cost model
+const size_t BAND_BYTES = 16 << 20; // Default size of a band of rows of the streaming mode in the board file
+const string CPU_DIRECTORY = "/sys/devices/system/cpu/"; // Topology of the CPUs in the sysfs
+const string NODE_DIRECTORY = "/sys/devices/system/node/"; // NUMA nodes and their CPUs in the sysfs
+
+/**
+ * @brief Kernels that compute the next state of one row of the slice.
+ */
+enum Kernel
+{
+    BRANCH, // Sum of neighbours and the rules applied cell by cell
+    LOOKUP // Next states of a block of cells looked up in a precomputed table
+};
+
+/**
+ * @brief Engines advancing the slice by generations.
+ */
+enum Engine
+{
+    BLOCKS, // All rows are computed by the kernels, several generations per halo exchange
+    CHANGELIST // Only the cells around the cells changed in the previous generation are evaluated, one generation per exchange
+};
+
+/**
+ * @brief Topologies of the board.
+ */
+enum Topology
+{
+    WALLS, // Cells outside the board are dead
+    TORUS // Board wraps around in both directions
+};
+
+/**
+ * @brief Transports of the ghost rows between the neighbouring slices.
+ */
+enum Transport
+{
+    SENDRECV, // Two MPI_Sendrecv calls, one for each direction
+    NEIGHBOR, // One MPI_Neighbor_alltoallw over the cartesian communicator
+    RMA, // MPI_Put into the ghost rows of the neighbours in a window, synchronised by post-start-complete-wait
+    SHARED, // Slices of a node in a shared window, the rows of the neighbours on the node are copied directly
+    COMPRESSED // Two MPI_Sendrecv calls of the ghost rows encoded by whichever of the encodings below is the smallest
+};
+
+/**
+ * @brief Progress of the halo exchange while the interior of the slice is computed.
+ */
+enum Progress
+{
+    BLOCKING, // The halo is exchanged before the block is computed
+    POLL, // Non-blocking exchange, tested by the computing thread after every tile
+    THREAD // Non-blocking exchange, driven by a progress thread while the interior is computed
+};
+
+/**
+ * @brief Rows of a block computed by one call of advanceBlock.
+ */
+enum Region
+{
+    WHOLE, // All rows of every generation
+    INTERIOR, // Rows that need no ghost rows and do not overwrite the rows being sent
+    BOUNDARY // The remaining rows, computed after the ghost rows arrive
+};
+
+/**
+ * @brief Encodings of the rows of the compressed halo, the first byte of the message.
+ */
+enum Encoding
+{
+    EMPTY, // No living cell, nothing follows
+    SPARSE, // Indices of the living cells follow (32 bits each)
+    BITMAP, // One bit per cell follows
+    UNCHANGED // The rows are the same as the last sent rows, nothing follows
+};
+
+/**
+ * @brief Generator of the initial board, used instead of the input file. Every process generates only its own slice.
+ */
+struct Generator
+{
+    enum Kind
+    {
+        NONE, // Board is read from the input file
+        RANDOM, // Cells are alive with the given density, decided by a counter-based random generator
+        TILE // Pattern from a file is repeated over the whole board
+    };
+
+    Kind kind = NONE; // Kind of the generated board
+    int rows = 0; // Number of rows of the board
+    int columns = 0; // Number of columns of the board
+    double density = 0; // Probability of a living cell (random board)
+    uint64_t seed = 0; // Seed of the random board
+    vector<vector<Cell>> pattern; // Tiled pattern (tile board)
+};
+
+/**
+ * @brief Options of the program given on the command line. They are parsed by every process.
+ */
+struct Options
+{
+    string inputFile; // Name of the file with the initial board
+    Generator generator; // Generator of the initial board (instead of the input file)
+    int generations = 0; // Number of steps to simulate
+    int depth = DEFAULT_DEPTH; // Number of generations computed per halo exchange (ghost rows on each side of the slice)
+    int tileRows = 0; // Number of rows in one cache tile (0 = derived from the size of the L2 cache)
+    Kernel kernel = BRANCH; // Kernel computing the rows
+    Engine engine = BLOCKS; // Engine advancing the slice
+    Topology topology = WALLS; // Topology of the board
+    Transport transport = SENDRECV; // Transport of the ghost rows
+    Progress progress = BLOCKING; // Overlap of the halo exchange with the computation
+    int processes = 0; // Number of processes computing the board (0 = chosen by the cost model)
+    bool bind = false; // Bind the process to a CPU chosen by the topology of the node
+    bool profile = false; // Measure the time of the phases of the generations loop and report them as JSON
+    string statistics; // File for the statistics of every generation (no statistics if empty)
+    string stream; // Output file of the streaming mode, the board stays on disk (no streaming if empty)
+    int bandRows = 0; // Number of rows of a band of the streaming mode (0 = derived from BAND_BYTES)
+    string batch; // Manifest of the boards of the batch mode (no batch if empty)
+    long long soups = 0; // Number of random soups of the census mode (no census if 0)
+    uint64_t soupSeed = 0; // Seed of the random soups of the census mode
+    bool prefix = true; // Print the rank of the process owning the row before every row of the board
+    unsigned birth = 1 << 3; // Bit n is set if a dead cell with n living neighbours is born (B3)
+    unsigned survival = 1 << 2 | 1 << 3; // Bit n is set if a living cell with n living neighbours survives (S23)
+};
+
+/**
+ * @brief Life-like rule with the birth and survival masks known at compile time.
+ *        Bit n of the mask is set if a cell with n living neighbours is born (dead cell) or survives (living cell).
+ */
+template <unsigned Birth, unsigned Survival>
+struct LifeRule
+{
+    static constexpr unsigned MASK = Birth | Survival << (MAX_NEIGHBOURS + 1); // Survival bits follow the birth bits
+
+    /**
+     * @brief Returns the next state of a cell, without any branching. The loop over the neighbour counts is unrolled
+     *        at compile time into comparisons with the counts of the masks, so the kernels using it can be vectorized.
+     * @param alive State of the cell.
+     * @param sum Number of living neighbours of the cell.
+     * @return Next state of the cell.
+     */
+    static constexpr Cell next(int alive, int sum)
+    {
+        int born = 0, survives = 0; // Cell with this number of neighbours is born / survives
+        for (int count = 0; count <= MAX_NEIGHBOURS; count++)
+        {
+            if ((Birth >> count) & 1) born |= sum == count;
+            if ((Survival >> count) & 1) survives |= sum == count;
+        }
+        return (alive & survives) | ((alive ^ 1) & born);
+    }
+};
+
+typedef LifeRule<1 << 3, 1 << 2 | 1 << 3> Conway; // B3/S23
+typedef LifeRule<1 << 3 | 1 << 6, 1 << 2 | 1 << 3> HighLife; // B36/S23
+typedef LifeRule<1 << 3 | 1 << 6 | 1 << 7 | 1 << 8, 1 << 3 | 1 << 4 | 1 << 6 | 1 << 7 | 1 << 8> DayAndNight; // B3678/S34678
+typedef LifeRule<1 << 2, 0> Seeds; // B2/S
+
+/**
+ * @brief Life-like rule with the masks given at run time (rules without their own specialized kernels).
+ */
+struct GenericRule
+{
+    static inline unsigned mask = Conway::MASK; // Birth bits followed by the survival bits, set once before the simulation
+
+    /**
+     * @brief Returns the next state of a cell, without any branching.
+     * @param alive State of the cell.
+     * @param sum Number of living neighbours of the cell.
+     * @return Next state of the cell.
+     */
+    static Cell next(int alive, int sum)
+    {
+        return (mask >> (sum + alive * (MAX_NEIGHBOURS + 1))) & 1;
+    }
+};
+
+/**
+ * @brief Table with the next states of `Width` neighbouring cells of a row for every neighbourhood of them.
+ *        The neighbourhood is 3 rows x (Width + 2) columns, every column gives 3 bits of the index
+ *        (row above, the row itself, row below). Bit i of the entry is the next state of the cell i of the block.
+ *        The table is generated at compile time.
+ */
+template <class Rule, int Width>
+struct LookupTable
+{
+    static constexpr int BITS = 3 * (Width + 2); // Number of bits of the index
+    Cell next[1 << BITS] = {}; // Next states of the block for every index
+
+    constexpr LookupTable()
+    {
+        for (int index = 0; index < (1 << BITS); index++) // For each neighbourhood
+        {
+            for (int cell = 0; cell < Width; cell++) // For each cell of the block (its column is cell + 1)
+            {
+                int alive = (index >> (3 * (cell + 1) + 1)) & 1;
+                int sum = -alive; // The cell itself is not its neighbour
+                for (int bit = 3 * cell; bit < 3 * (cell + 3); bit++) sum += (index >> bit) & 1;
+                next[index] |= Rule::next(alive, sum) << cell;
+            }
+        }
+    }
+};
+
+template <class Rule>
+constexpr LookupTable<Rule, LOOKUP_WIDTH> lookupTable{}; // Table of the rule used by the lookup kernel
+
+/**
+ * @brief Returns the table of the rule used by the lookup kernel, generated at compile time.
+ * @return Next states of the blocks.
+*/
+template <class Rule>
+const Cell *lookupTableOf()
+{
+    return lookupTable<Rule>.next;
+}
+
+/**
+ * @brief Returns the table of the generic rule, generated at run time on the first use (the masks are known then).
+ * @return Next states of the blocks.
+*/
+template <>
+const Cell *lookupTableOf<GenericRule>()
+{
+    static LookupTable<GenericRule, LOOKUP_WIDTH> table;
+    static unsigned built = GenericRule::mask; // Rule of the table (the batch mode changes the rule between boards)
+    if (built != GenericRule::mask)
+    {
+        table = LookupTable<GenericRule, LOOKUP_WIDTH>();
+        built = GenericRule::mask;
+    }
+    return table.next;
+}
+
+typedef void (*RowKernel)(const Cell *top, const Cell *mid, const Cell *bottom, Cell *out, int columns); // Kernel computing one row
+
+/**
+ * @brief Slice of the board owned by one process. Rows are stored with `halo` ghost rows above and below them,
+ *        so the rows of the neighbouring slices lie in place next to the own rows, and every row has a ghost column
+ *        on each side (dead cells of a wall, or copies of the columns on the other side of a torus).
+ *        There are two planes of the slice, generations are computed from one plane into the other one.
+ */
+struct Slice
+{
+    int rows = 0; // Number of rows owned by the process
+    int columns = 0; // Number of columns of the board
+    int stride = 0; // Number of cells of a stored row (columns and the two ghost columns)
+    int halo = 0; // Number of ghost rows on each side of the slice
+    int firstRow = 0; // Row of the board with the first own row of the slice
+    bool torus = false; // Ghost columns are copies of the columns on the other side of the board
+    vector<Cell> storage; // Private memory of the slice (unused when the slice is moved to a shared window)
+    Cell *cells = nullptr; // Both planes, each of (rows + 2 * halo) * stride cells
+    size_t size = 0; // Number of allocated cells
+    vector<array<int, 2>> spans[2]; // Columns [first, last) outside of which the stored rows of each plane are dead (empty if not tracked)
+
+    /**
+     * @brief Returns pointer to the row of the slice, rows -halo..-1 and rows..rows+halo-1 are the ghost rows.
+     *        Cells -1 and columns of the row are the ghost columns.
+     * @param plane Plane of the slice (0 or 1).
+     * @param row Index of the row within the slice.
+     * @return Pointer to the first cell of the row.
+     */
+    Cell *row(int plane, int row)
+    {
+        return cells + ((size_t)plane * (rows + 2 * halo) + (row + halo)) * stride + 1;
+    }
+
+    /**
+     * @brief Returns pointer to the stored row including the ghost columns, consecutive rows are contiguous from it.
+     * @param plane Plane of the slice (0 or 1).
+     * @param row Index of the row within the slice.
+     * @return Pointer to the left ghost column of the row.
+     */
+    Cell *paddedRow(int plane, int row)
+    {
+        return this->row(plane, row) - 1;
+    }
+
+    /**
+     * @brief Returns the columns of a row outside of which all cells are dead (first > last for a dead row).
+     * @param plane Plane of the slice (0 or 1).
+     * @param row Index of the row within the slice.
+     * @return First column and the column after the last one that may be alive.
+     */
+    array<int, 2> &span(int plane, int row)
+    {
+        return spans[plane][row + halo];
+    }
+
+    /**
+     * @brief Starts tracking the living columns of the rows, all rows of both planes may be alive anywhere.
+     * @return void
+     */
+    void track()
+    {
+        for (int plane = 0; plane < 2; plane++) spans[plane].assign(rows + 2 * halo, {0, columns});
+    }
+
+    /**
+     * @brief Sets the span of a row to its living cells between the given columns (the rest of the row is dead).
+     *        The row is scanned by 8 cells at once from both ends, so a dense row costs almost nothing.
+     * @param plane Plane of the slice (0 or 1).
+     * @param row Index of the row within the slice.
+     * @param from First column that may be alive.
+     * @param to Column after the last one that may be alive.
+     * @return void
+     */
+    void measure(int plane, int row, int from, int to)
+    {
+        const Cell *cells = this->row(plane, row);
+        uint64_t word;
+        while (from + 8 <= to && (memcpy(&word, cells + from, 8), word == 0)) from += 8;
+        while (from < to && !cells[from]) from++;
+        while (to - 8 >= from && (memcpy(&word, cells + to - 8, 8), word == 0)) to -= 8;
+        while (to > from && !cells[to - 1]) to--;
+        span(plane, row) = from < to ? array<int, 2>{from, to} : array<int, 2>{columns, 0};
+    }
+
+    /**
+     * @brief Moves the slice to other memory of the same size, the private memory is released.
+     * @param memory Memory for all cells of the slice.
+     * @return void
+     */
+    void moveTo(Cell *memory)
+    {
+        memcpy(memory, cells, size);
+        cells = memory;
+        vector<Cell>().swap(storage);
+    }
+
+    /**
+     * @brief Copies the edge columns of a row into the ghost columns on the other side (torus only, walls stay dead).
+     * @param plane Plane of the slice (0 or 1).
+     * @param row Index of the row within the slice.
+     * @return void
+     */
+    void wrapColumns(int plane, int row)
+    {
+        if (!torus) return;
+        Cell *cells = this->row(plane, row);
+        cells[-1] = cells[columns - 1];
+        cells[columns] = cells[0];
+    }
+};
+
+/**
+ * @brief Phases of the generations loop measured by the profiler.
+ */
+enum Phase
+{
+    INPUT, // Reading and distributing the board
+    PACK, // Preparing the halo rows for sending
+    HALO, // Sending and waiting for the halo rows
+    COMPUTE, // Kernel computing the generations
+    SWAP, // Swapping the planes of the slice
+    OUTPUT, // Collecting and printing the board
+    PHASES // Number of the phases
+};
+
+const char *PHASE_NAMES[PHASES] = {"input", "pack", "halo", "compute", "swap", "output"}; // Names of the phases in the report
+
+/**
+ * @brief Accumulates the wall time of the phases of one process. The time of a phase is the time since the end
+ *        of the previous phase (or since `start`), measured by the steady clock. It makes no MPI call, so it can be read
+ *        while the progress thread is calling MPI.
+ *        When it is disabled, it does not read the clock at all.
+ */
+struct Profiler
+{
+    bool enabled = false; // Measure the phases
+    double time[PHASES] = {}; // Seconds spent in the phases
+    double last = 0; // Time of the end of the previous phase
+    double haloBytes = 0; // Bytes of the halo rows sent to the neighbours
+
+    /**
+     * @brief Starts measuring the next phase.
+     * @return void
+     */
+    void start()
+    {
+        if (enabled) last = now();
+    }
+
+    /**
+     * @brief Adds the time since the end of the previous phase to the phase.
+     * @param phase Phase that just ended.
+     * @return void
+     */
+    void end(Phase phase)
+    {
+        if (!enabled) return;
+        double time = now();
+        this->time[phase] += time - last;
+        last = time;
+    }
+
+    /**
+     * @brief Returns the time of the steady clock.
+     * @return Seconds since the epoch of the clock.
+     */
+    static double now()
+    {
+        return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+/**
+ * @brief Statistics of one generation: population, births, deaths and the bounding box of the living cells.
+ */
+struct Statistics
+{
+    long long population = 0; // Number of living cells
+    long long births = 0; // Number of cells that were born in this generation
+    long long deaths = 0; // Number of cells that died in this generation
+    int minRow = INT_MAX, minColumn = INT_MAX; // Top left corner of the bounding box (INT_MAX if there is no living cell)
+    int maxRow = -1, maxColumn = -1; // Bottom right corner of the bounding box (-1 if there is no living cell)
+};
+
+/**
+ * @brief Formatter of the printed board. Whole rows are converted to characters in a preallocated buffer,
+ *        which is written to the standard output by one call when it is full.
+ */
+struct OutputBuffer
+{
+    vector<char> buffer; // Characters waiting for the write
+    size_t used = 0; // Number of characters in the buffer
+    bool prefix = true; // Print the rank before every row
+    int fd = STDOUT_FILENO; // File the buffer is written to
+
+    /**
+     * @brief Allocates the buffer, it holds at least one row.
+     * @param columns Number of columns of the board.
+     * @param prefix Print the rank before every row.
+     * @param fd File the buffer is written to (standard output by default).
+     */
+    OutputBuffer(int columns, bool prefix, int fd = STDOUT_FILENO) : buffer(max(OUTPUT_BUFFER, (size_t)columns + 16)), prefix(prefix), fd(fd) {}
+
+    ~OutputBuffer() { flush(); }
+
+    /**
+     * @brief Appends one row of the board.
+     * @param rank Rank of the process owning the row.
+     * @param cells Cells of the row.
+     * @param columns Number of columns of the board.
+     * @return void
+     */
+    void row(int rank, const Cell *cells, int columns)
+    {
+        if (buffer.size() - used < (size_t)columns + 16) flush(); // Rank, ": ", the cells and the new line
+        char *out = buffer.data() + used;
+        if (prefix) out += sprintf(out, "%d: ", rank);
+        for (int y = 0; y < columns; y++) out[y] = '0' + cells[y]; // Branch-free, vectorized by the compiler
+        out[columns] = '\n';
+        used = out + columns + 1 - buffer.data();
+    }
+
+    /**
+     * @brief Writes the buffer to its file.
+     * @return void
+     */
+    void flush()
+    {
+        for (size_t written = 0; written < used; )
+        {
+            ssize_t n = write(fd, buffer.data() + written, used - written);
+            if (n < 0) break; // Nothing can be printed (e.g. closed output)
+            written += n;
+        }
+        used = 0;
+    }
+};
+
+/**
+ * @brief Prints the usage of the program and aborts the MPI execution environment.
+ * @param rank Rank of the process, only the root prints the message.
+ * @return void
+*/
+void usage(int rank)
+{
+    if (rank == MASTER)
+    {
+        cerr << "Usage: ./test.sh <input file> <number of generations> [options]" << endl;
+        cerr << "       life --generate random:<width>x<height>:<density>:<seed>|tile:<width>x<height>:<pattern file> <number of generations> [options]" << endl;
+        cerr << "       life <input file> <number of generations> --stream <output file> [--band-rows <rows>] [options]" << endl;
+        cerr << "       life --batch <manifest> [options]" << endl;
+        cerr << "       life --census <soups>[:<seed>] <maximum generations> [options]" << endl;
+        cerr << "Options: [--depth <generations>] [--tile-rows <rows>] [--kernel branch|lookup] [--engine blocks|changelist] [--rule B<digits>/S<digits>] [--topology walls|torus] [--halo sendrecv|neighbor|rma|shared|compressed] [--progress blocking|poll|thread] [--processes auto|all|<count>] [--bind none|cores] [--profile] [--stats <file>] [--no-prefix]" << endl;
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+}
+
+/**
+ * @brief Parses the rule in B/S notation (for example B36/S23) into the birth and survival masks.
+ * @param rule Rule in B/S notation.
+ * @param birth Mask of the neighbour counts of a birth.
+ * @param survival Mask of the neighbour counts of a survival.
+ * @return True if the rule is valid.
+*/
+bool parseRule(const string &rule, unsigned &birth, unsigned &survival)
+{
+    size_t slash = rule.find('/');
+    if (slash == string::npos || slash == 0 || slash + 1 >= rule.size()) return false;
+    if (toupper(rule[0]) != 'B' || toupper(rule[slash + 1]) != 'S') return false;
+
+    birth = survival = 0;
+    for (size_t i = 1; i < rule.size(); i++)
+    {
+        if (i == slash || i == slash + 1) continue; // Separator and the letter S
+        int count = rule[i] - '0'; // Number of living neighbours
+        if (count < 0 || count > MAX_NEIGHBOURS) return false;
+        (i < slash ? birth : survival) |= 1u << count;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a board from a file, every line is one row of 0s and 1s.
+ * @param name Name of the file.
+ * @param board Rows of the board.
+ * @return True if the file could be opened.
+*/
+bool readBoard(const string &name, vector<vector<Cell>> &board)
+{
+    ifstream file(name); // Input file
+    if (!file) return false;
+
+    string line; // Line of the board
+    while (getline(file, line))
+    {
+        vector<Cell> row;
+        // '0' have ASCII value of 48 and numbers (1-9) have ASCII values from 49 to 57. This way we convert char to int
+        for (char c : line) row.push_back(c - '0');
+        board.push_back(row);
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that the board is not empty, all rows have the same length and all cells are 0 or 1.
+ * @param board Rows of the board.
+ * @return True if the board is valid.
+*/
+bool validBoard(const vector<vector<Cell>> &board)
+{
+    if (board.empty() || board[0].empty()) return false;
+    for (const vector<Cell> &row : board)
+    {
+        if (row.size() != board[0].size()) return false;
+        for (Cell cell : row) if (cell > 1) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses the specification of the generated board: random:<width>x<height>:<density>:<seed>
+ *        or tile:<width>x<height>:<pattern file>. The pattern file is read by every process (it is small).
+ * @param spec Specification of the board.
+ * @param generator Parsed generator.
+ * @return True if the specification is valid.
+*/
+bool parseGenerator(const string &spec, Generator &generator)
+{
+    vector<string> parts; // Parts of the specification separated by ':'
+    size_t start = 0, colon;
+    while ((colon = spec.find(':', start)) != string::npos)
+    {
+        parts.push_back(spec.substr(start, colon - start));
+        start = colon + 1;
+    }
+    parts.push_back(spec.substr(start));
+
+    if (parts.size() < 2 || sscanf(parts[1].c_str(), "%dx%d", &generator.columns, &generator.rows) != 2) return false;
+    if (generator.rows < 1 || generator.columns < 1) return false;
+
+    if (parts[0] == "random" && (parts.size() == 3 || parts.size() == 4))
+    {
+        generator.kind = Generator::RANDOM;
+        generator.density = atof(parts[2].c_str());
+        generator.seed = parts.size() == 4 ? strtoull(parts[3].c_str(), nullptr, 10) : 0;
+        return generator.density >= 0 && generator.density <= 1;
+    }
+    if (parts[0] == "tile" && parts.size() == 3)
+    {
+        generator.kind = Generator::TILE;
+        return readBoard(parts[2], generator.pattern) && validBoard(generator.pattern); // Cells 0 or 1, the kernels index tables by them
+    }
+    return false;
+}
+
+/**
+ * @brief Parses the command-line arguments into the options.
+ * @param rank Rank of the process.
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line arguments.
+ * @return Parsed options.
+*/
+Options parseOptions(int rank, int argc, char *argv[])
+{
+    Options options;
+    vector<string> positional; // Arguments that are not options (input file, unless the board is generated, and number of generations)
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) options.depth = atoi(argv[++i]);
+        else if (arg == "--tile-rows" && i + 1 < argc) options.tileRows = atoi(argv[++i]);
+        else if (arg == "--kernel" && i + 1 < argc)
+        {
+            string kernel = argv[++i];
+            if (kernel == "branch") options.kernel = BRANCH;
+            else if (kernel == "lookup") options.kernel = LOOKUP;
+            else usage(rank);
+        }
+        else if (arg == "--engine" && i + 1 < argc)
+        {
+            string engine = argv[++i];
+            if (engine == "blocks") options.engine = BLOCKS;
+            else if (engine == "changelist") options.engine = CHANGELIST;
+            else usage(rank);
+        }
+        else if (arg == "--rule" && i + 1 < argc)
+        {
+            if (!parseRule(argv[++i], options.birth, options.survival)) usage(rank);
+        }
+        else if (arg == "--topology" && i + 1 < argc)
+        {
+            string topology = argv[++i];
+            if (topology == "walls") options.topology = WALLS;
+            else if (topology == "torus") options.topology = TORUS;
+            else usage(rank);
+        }
+        else if (arg == "--halo" && i + 1 < argc)
+        {
+            string transport = argv[++i];
+            if (transport == "sendrecv") options.transport = SENDRECV;
+            else if (transport == "neighbor") options.transport = NEIGHBOR;
+            else if (transport == "rma") options.transport = RMA;
+            else if (transport == "shared") options.transport = SHARED;
+            else if (transport == "compressed") options.transport = COMPRESSED;
+            else usage(rank);
+        }
+        else if (arg == "--progress" && i + 1 < argc)
+        {
+            string progress = argv[++i];
+            if (progress == "blocking") options.progress = BLOCKING;
+            else if (progress == "poll") options.progress = POLL;
+            else if (progress == "thread") options.progress = THREAD;
+            else usage(rank);
+        }
+        else if (arg == "--processes" && i + 1 < argc)
+        {
+            string processes = argv[++i];
+            if (processes == "auto") options.processes = 0;
+            else if (processes == "all") options.processes = INT_MAX;
+            else if ((options.processes = atoi(processes.c_str())) < 1) usage(rank);
+        }
+        else if (arg == "--bind" && i + 1 < argc)
+        {
+            string bind = argv[++i];
+            if (bind == "none") options.bind = false;
+            else if (bind == "cores") options.bind = true;
+            else usage(rank);
+        }
+        else if (arg == "--profile") options.profile = true;
+        else if (arg == "--stats" && i + 1 < argc) options.statistics = argv[++i];
+        else if (arg == "--no-prefix") options.prefix = false;
+        else if (arg == "--stream" && i + 1 < argc) options.stream = argv[++i];
+        else if (arg == "--band-rows" && i + 1 < argc)
+        {
+            if ((options.bandRows = atoi(argv[++i])) < 1) usage(rank);
+        }
+        else if (arg == "--batch" && i + 1 < argc) options.batch = argv[++i];
+        else if (arg == "--census" && i + 1 < argc)
+        {
+            string census = argv[++i];
+            size_t colon = census.find(':');
+            options.soups = atoll(census.substr(0, colon).c_str());
+            if (colon != string::npos) options.soupSeed = strtoull(census.c_str() + colon + 1, nullptr, 10);
+            if (options.soups < 1) usage(rank);
+        }
+        else if (arg == "--generate" && i + 1 < argc)
+        {
+            if (!parseGenerator(argv[++i], options.generator)) usage(rank);
+        }
+        else if (arg.rfind("--", 0) == 0) usage(rank); // Unknown option or option without value
+        else positional.push_back(arg);
+    }
+
+    bool generated = options.generator.kind != Generator::NONE;
+    // Options of the distributed board of the generations loop (statistics, profile, halo, overlap, active processes, rank prefix)
+    bool distributed = !options.statistics.empty() || options.profile || options.transport != SENDRECV || options.progress != BLOCKING ||
+                       options.processes != 0 || !options.prefix;
+    if (!options.batch.empty()) // The boards and their generations are listed in the manifest
+    {
+        if (!positional.empty() || generated || options.soups > 0 || !options.stream.empty() || distributed) usage(rank); // Whole boards per process
+        if (options.depth < 1 || options.tileRows < 0 || options.engine != BLOCKS || options.bandRows > 0) usage(rank);
+        return options;
+    }
+    bool single = generated || options.soups > 0; // Only the number of generations is positional
+    if (positional.size() != (single ? 1 : 2) || (generated && options.soups > 0) || options.depth < 1 || options.tileRows < 0) usage(rank);
+    if (options.progress != BLOCKING && options.transport != SENDRECV) usage(rank); // Overlap uses non-blocking point-to-point calls
+    if (options.progress == THREAD && options.bind) usage(rank); // The bound progress thread would spin on the core of the computing thread
+    if (!options.stream.empty() && (single || distributed)) usage(rank); // Streaming reads and writes board files only, by bands
+    if (options.bandRows > 0 && options.stream.empty()) usage(rank); // Bands exist only in the streaming mode
+    // Soups are stepped one generation at a time on a board with walls, whole by one process
+    if (options.soups > 0 && (distributed || options.topology != WALLS || options.depth != DEFAULT_DEPTH || options.tileRows != 0)) usage(rank);
+    // The change list is an engine of the generations loop, exchanging the halo before every generation
+    if (options.engine == CHANGELIST && (options.soups > 0 || !options.stream.empty() || !options.statistics.empty() || options.progress != BLOCKING)) usage(rank);
+    // It neither runs the kernels nor blocks generations, so the kernel, depth and tiles are not its options
+    if (options.engine == CHANGELIST && (options.kernel != BRANCH || options.depth != DEFAULT_DEPTH || options.tileRows != 0)) usage(rank);
+    if (!single) options.inputFile = positional[0];
+    options.generations = atoi(positional.back().c_str());
+    if (options.generations < 0)
+    {
+        if (rank == MASTER) cerr << "Number of generations must be a non-negative integer" << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+    }
+    return options;
+}
+
+/**
+ * @brief Allocates both planes of the slice, all cells (including the ghost rows and columns) are dead.
+ * @param slice Slice to allocate.
+ * @param rows Number of rows owned by the process.
+ * @param columns Number of columns of the board.
+ * @param halo Number of ghost rows on each side of the slice.
+ * @param torus True if the board wraps around.
+ * @return void
+*/
+void allocateSlice(Slice &slice, int rows, int columns, int halo, bool torus)
+{
+    slice.rows = rows;
+    slice.columns = columns;
+    slice.stride = columns + 2;
+    slice.halo = halo;
+    slice.torus = torus;
+    // The lookup kernel reads the columns of a whole block, up to LOOKUP_WIDTH - 1 cells behind the last padded row
+    slice.storage.assign(2 * (size_t)(rows + 2 * halo) * slice.stride + LOOKUP_WIDTH, 0);
+    slice.cells = slice.storage.data();
+    slice.size = slice.storage.size();
+}
+
+/**
+ * @brief Creates the datatype of the own rows of a plane of the slice without the ghost columns, starting at the first own row,
+ *        so the rows are sent and received straight from and into the slice.
+ * @param slice Slice of the process.
+ * @return Committed datatype (to be freed by the caller).
+*/
+MPI_Datatype ownRowsType(const Slice &slice)
+{
+    MPI_Datatype type;
+    MPI_Type_vector(slice.rows, slice.columns, slice.stride, MPI_UNSIGNED_CHAR, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+/**
+ * @brief Fills the ghost columns of the own rows of the first plane after they are received or copied into the slice.
+ * @param slice Slice of the process.
+ * @return void
+*/
+void wrapSlice(Slice &slice)
+{
+    for (int x = 0; x < slice.rows; x++) slice.wrapColumns(0, x);
+}
+
+/**
+ * @brief Reads and validates the board of the input file (root only).
+ * @param options Options of the program.
+ * @param board Rows of the board.
+ * @return void
+*/
+void readInput(const Options &options, vector<vector<Cell>> &board)
+{
+    // Read the board from a file to a 2D vector of cells
+    if (!readBoard(options.inputFile, board))
+    {
+        cerr << "Error opening file (Try checking the name of file)" << endl;
+        cerr << "Usage: ./test.sh <input file> <number of generations>" << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+    }
+
+    if (!validBoard(board))
+    {
+        cerr << "Invalid board (rows must have the same length and contain only 0s and 1s)" << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+    }
+}
+
+/**
+ * @brief Returns the number of rows of the slice of a process, the first rows % size slices have one more row.
+ * @param rank Rank of the process.
+ * @param size Number of processes.
+ * @param rows Number of rows of the board.
+ * @return Number of rows of the slice.
+*/
+int sliceRowsOf(int rank, int size, int rows)
+{
+    return rows / size + (rank < rows % size);
+}
+
+/**
+ * @brief Returns the row of the board with the first row of the slice of a process.
+ * @param rank Rank of the process.
+ * @param size Number of processes.
+ * @param rows Number of rows of the board.
+ * @return First row of the slice.
+*/
+int firstRowOf(int rank, int size, int rows)
+{
+    return rank * (rows / size) + min(rank, rows % size);
+}
+
+/**
+ * @brief Chooses the number of processes computing the board, by a cost model of one run: the cells of the largest slice
+ *        for every generation, the rows recomputed in the ghost rows, and two halo messages per block of generations.
+ *        More processes than rows are never used. The number of processes can be also given by the options.
+ * @param size Number of processes of the job.
+ * @param rows Number of rows of the board.
+ * @param columns Number of columns of the board.
+ * @param options Options of the program.
+ * @return Number of active processes.
+*/
+int activeProcesses(int size, int rows, int columns, const Options &options)
+{
+    if (options.processes > 0) return min(options.processes, min(size, rows));
+
+    int best = 1; // Number of processes with the lowest cost
+    double bestCost = 0;
+    for (int p = 1; p <= min(size, rows); p++)
+    {
+        int depth = min(options.depth, rows / p); // Number of ghost rows (the same for all slices)
+        double blocks = (options.generations + depth - 1) / depth; // Number of halo exchanges
+        double cells = (double)sliceRowsOf(0, p, rows) * columns * options.generations; // Own cells of the largest slice
+        bool exchange = p > 1 || options.topology == TORUS;
+        if (exchange) cells += blocks * depth * (depth - 1) * columns; // Trapezoids in the ghost rows on both sides
+        double cost = cells * CELL_SECONDS;
+        if (exchange) cost += blocks * 2 * (LATENCY_SECONDS + (double)depth * (columns + 2) * BYTE_SECONDS);
+        if (p == 1 || cost < bestCost)
+        {
+            best = p;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Function for root process (rank = 0), that sends the slices of the board to all other active processes.
+ *        The slice of the root is stored directly into its own slice (sending to itself could block on large slices).
+ * @param size Number of active processes.
+ * @param board Rows of the board.
+ * @param slice Slice of the root process (allocated).
+ * @param comm Communicator of the active processes.
+ * @return void
+*/
+void processRoot(int size, const vector<vector<Cell>> &board, Slice &slice, MPI_Comm comm)
+{
+    int rows = board.size();
+    int columns = board[0].size();
+    for (int p = 0; p < size; p++) // For each processor (thread)
+    {
+        int sliceRows = sliceRowsOf(p, size, rows), firstRow = firstRowOf(p, size, rows);
+        if (p == MASTER) // Root's own rows go straight into its slice
+        {
+            for (int row = 0; row < sliceRows; row++) copy(board[row].begin(), board[row].end(), slice.row(0, row));
+            wrapSlice(slice);
+            continue;
+        }
+        // The rows of the board are sent where they are, described by their addresses, without packing them into one buffer
+        vector<int> lengths(sliceRows, columns); // Every row of a slice is one block of the datatype
+        vector<MPI_Aint> addresses(sliceRows); // Addresses of the rows of a slice in the board
+        for (int row = 0; row < sliceRows; row++) MPI_Get_address(board[firstRow + row].data(), &addresses[row]);
+        MPI_Datatype rowsType;
+        MPI_Type_create_hindexed(sliceRows, lengths.data(), addresses.data(), MPI_UNSIGNED_CHAR, &rowsType);
+        MPI_Type_commit(&rowsType);
+        MPI_Send(MPI_BOTTOM, 1, rowsType, p, 2, comm); // And send it to all processors
+        MPI_Type_free(&rowsType);
+    }
+}
+
+/**
+ * @brief Prints the board of the input file without any generation. Only the root reads and prints it, there is
+ *        no scatter and no message, so a run with 0 generations only validates and converts the board.
+ * @param rank Rank of the process.
+ * @param options Options of the program.
+ * @return void
+*/
+void printInitialBoard(int rank, const Options &options)
+{
+    if (rank != MASTER) return;
+
+    vector<vector<Cell>> board; // 2D vector representing the board
+    readInput(options, board);
+
+    OutputBuffer output(board[0].size(), options.prefix);
+    for (const vector<Cell> &row : board) output.row(rank, row.data(), row.size()); // Rows in the order of the file
+}
+
+/**
+ * @brief Counter-based random number generator (SplitMix64 finalizer), the number depends only on the seed and the counter.
+ * @param seed Seed of the generator.
+ * @param counter Counter (index of the cell in the whole board).
+ * @return Random 64-bit number.
+*/
+uint64_t randomAt(uint64_t seed, uint64_t counter)
+{
+    uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Generates the own rows of the slice. Every cell depends only on its position in the whole board,
+ *        so the board is the same for any number of processes, and no input file or scatter is needed.
+ * @param slice Slice of the process (allocated).
+ * @param generator Generator of the board.
+ * @param firstRow Row of the board with the first row of the slice.
+ * @return void
+*/
+void generateSlice(Slice &slice, const Generator &generator, int firstRow)
+{
+    const double scale = 1.0 / 9007199254740992.0; // 2^-53, random 53-bit number to [0, 1)
+    for (int x = 0; x < slice.rows; x++)
+    {
+        uint64_t row = firstRow + x; // Row of the board
+        Cell *cells = slice.row(0, x);
+        for (int y = 0; y < slice.columns; y++)
+        {
+            if (generator.kind == Generator::RANDOM) cells[y] = (randomAt(generator.seed, row * generator.columns + y) >> 11) * scale < generator.density;
+            else
+            {
+                const vector<Cell> &line = generator.pattern[row % generator.pattern.size()];
+                cells[y] = line[y % line.size()];
+            }
+        }
+        slice.wrapColumns(0, x);
+    }
+}
+
+/**
+ * @brief Computes the next state of one row of cells from the row itself and the rows above and below it.
+ *        The rule is a template parameter and the rows have ghost columns, so the loop has no branches at all
+ *        and it can be vectorized.
+ * @param top Row above the computed row.
+ * @param mid Computed row.
+ * @param bottom Row below the computed row.
+ * @param out Row where the new states of the cells are stored.
+ * @param columns Number of columns of the board.
+ * @return void
+*/
+template <class Rule>
+void computeRow(const Cell *top, const Cell *mid, const Cell *bottom, Cell *out, int columns)
+{
+    for (int y = 0; y < columns; y++) // For each column in the row (columns -1 and columns are the ghost columns)
+    {
+        // Sum of the living cells in the three columns around the cell, without the cell itself
+        int sum = top[y - 1] + top[y] + top[y + 1] + mid[y - 1] + mid[y + 1] + bottom[y - 1] + bottom[y] + bottom[y + 1];
+
+        // Apply the rules of the game to each cell using sum, which now contains the number of living neighbors of the cell
+        out[y] = Rule::next(mid[y], sum);
+    }
+}
+
+/**
+ * @brief Computes the next state of one row of cells by looking up blocks of `LOOKUP_WIDTH` cells in the table of the rule.
+ *        The index of the table slides along the row, every block shifts in the columns to the right of it.
+ * @param top Row above the computed row.
+ * @param mid Computed row.
+ * @param bottom Row below the computed row.
+ * @param out Row where the new states of the cells are stored.
+ * @param columns Number of columns of the board.
+ * @return void
+*/
+template <class Rule>
+void computeRowLookup(const Cell *top, const Cell *mid, const Cell *bottom, Cell *out, int columns)
+{
+    const Cell *table = lookupTableOf<Rule>();
+
+    // Three cells of a column as 3 bits (columns -1 and columns are the ghost columns)
+    auto column = [&](int y) -> unsigned { return top[y] | mid[y] << 1 | bottom[y] << 2; };
+
+    unsigned index = 0; // Neighbourhood of the block, column y - 1 of the block starting at y is in the lowest bits
+    for (int c = 0; c < LOOKUP_WIDTH + 2; c++) index |= column(c - 1) << (3 * c);
+
+    for (int y = 0; y < columns; y += LOOKUP_WIDTH) // For each block of the row
+    {
+        Cell next = table[index];
+        for (int cell = 0; cell < LOOKUP_WIDTH && y + cell < columns; cell++) out[y + cell] = (next >> cell) & 1;
+        if (y + LOOKUP_WIDTH >= columns) break; // Last block, no columns are read behind it
+
+        index >>= 3 * LOOKUP_WIDTH; // Columns shared with the next block
+        for (int c = 2; c < LOOKUP_WIDTH + 2; c++) index |= column(y + LOOKUP_WIDTH + c - 1) << (3 * c); // New columns of the next block
+    }
+}
+
+/**
+ * @brief Returns the kernel of the chosen type for the rule.
+ * @param kernel Type of the kernel.
+ * @return Kernel computing the rows.
+*/
+template <class Rule>
+RowKernel kernelFor(Kernel kernel)
+{
+    return kernel == LOOKUP ? computeRowLookup<Rule> : computeRow<Rule>;
+}
+
+/**
+ * @brief Selects the kernel for the rule of the options. Common rules have their own kernels specialized at compile time,
+ *        other rules use the kernel of the generic rule with the masks set at run time.
+ * @param options Options of the program.
+ * @return Kernel computing the rows.
+*/
+RowKernel selectKernel(const Options &options)
+{
+    unsigned mask = options.birth | options.survival << (MAX_NEIGHBOURS + 1);
+
+    if (mask == Conway::MASK) return kernelFor<Conway>(options.kernel);
+    if (mask == HighLife::MASK) return kernelFor<HighLife>(options.kernel);
+    if (mask == DayAndNight::MASK) return kernelFor<DayAndNight>(options.kernel);
+    if (mask == Seeds::MASK) return kernelFor<Seeds>(options.kernel);
+
+    GenericRule::mask = mask;
+    return kernelFor<GenericRule>(options.kernel);
+}
+
+/**
+ * @brief Adds one computed row to the statistics of its generation. Cells are bytes 0 or 1, so the counters are
+ *        branch-free sums of the bytes of the row, which the compiler vectorizes like the kernels.
+ * @param before Row in the previous generation.
+ * @param after Row in the new generation.
+ * @param columns Number of columns of the board.
+ * @param row Row of the board.
+ * @param statistics Statistics of the generation.
+ * @return void
+*/
+void countRow(const Cell *before, const Cell *after, int columns, int row, Statistics &statistics)
+{
+    int population = 0, births = 0, deaths = 0;
+    for (int y = 0; y < columns; y++)
+    {
+        population += after[y];
+        births += after[y] & (before[y] ^ 1);
+        deaths += before[y] & (after[y] ^ 1);
+    }
+
+    statistics.population += population;
+    statistics.births += births;
+    statistics.deaths += deaths;
+    if (population == 0) return; // The row is not in the bounding box
+
+    int first = 0, last = columns - 1; // First and last living cell of the row
+    while (!after[first]) first++;
+    while (!after[last]) last--;
+    statistics.minRow = min(statistics.minRow, row);
+    statistics.maxRow = max(statistics.maxRow, row);
+    statistics.minColumn = min(statistics.minColumn, first);
+    statistics.maxColumn = max(statistics.maxColumn, last);
+}
+
+/**
+ * @brief Computes one row only within the living columns of the three rows above it, around it and below it,
+ *        widened by one column (dead rows are skipped entirely). Cells outside them stay dead, so only the cells
+ *        left alive in the row two generations ago are cleared there. The span of the row is then set from the new cells.
+ *        On a torus, a living edge column is a neighbour of the opposite one, so such rows are computed whole.
+ * @param slice Slice of the process (tracked).
+ * @param src Plane with generation t-1.
+ * @param dst Plane for generation t.
+ * @param x Index of the row within the slice.
+ * @param kernel Kernel computing the rows.
+ * @return void
+*/
+void computeLiveColumns(Slice &slice, int src, int dst, int x, RowKernel kernel)
+{
+    const array<int, 2> &top = slice.span(src, x - 1), &mid = slice.span(src, x), &bottom = slice.span(src, x + 1);
+    int from = min(top[0], min(mid[0], bottom[0])), to = max(top[1], max(mid[1], bottom[1])); // Living columns around the row
+    if (from < to && slice.torus && (from == 0 || to == slice.columns))
+    {
+        from = 0;
+        to = slice.columns;
+    }
+    else if (from < to)
+    {
+        from = max(0, from - 1);
+        to = min(slice.columns, to + 1);
+    }
+
+    Cell *out = slice.row(dst, x);
+    array<int, 2> &old = slice.span(dst, x); // Cells that may be alive from two generations ago
+    if (from >= to)
+    {
+        if (old[0] < old[1]) memset(out + old[0], 0, old[1] - old[0]);
+        old = {slice.columns, 0};
+        return;
+    }
+    if (old[0] < from) memset(out + old[0], 0, min(old[1], from) - old[0]);
+    if (old[1] > to) memset(out + max(old[0], to), 0, old[1] - max(old[0], to));
+    kernel(slice.row(src, x - 1) + from, slice.row(src, x) + from, slice.row(src, x + 1) + from, out + from, to - from);
+    slice.measure(dst, x, from, to);
+}
+
+/**
+ * @brief Computes the rows [from, to) of generation t of the block.
+ * @param slice Slice of the process.
+ * @param plane Plane with the first generation of the block.
+ * @param t Generation of the block.
+ * @param from First row.
+ * @param to Row after the last row.
+ * @param kernel Kernel computing the rows.
+ * @param statistics Statistics of the generations of the block (own rows only), if they are collected.
+ * @return void
+*/
+template <bool Collect>
+void computeRows(Slice &slice, int plane, int t, int from, int to, RowKernel kernel, Statistics *statistics)
+{
+    int src = (plane + t - 1) % 2; // Plane with generation t-1
+    int dst = (plane + t) % 2; // Plane for generation t
+
+    for (int x = from; x < to; x++) // For each row
+    {
+        if (slice.spans[0].empty()) kernel(slice.row(src, x - 1), slice.row(src, x), slice.row(src, x + 1), slice.row(dst, x), slice.columns);
+        else computeLiveColumns(slice, src, dst, x, kernel);
+        slice.wrapColumns(dst, x);
+        if (Collect && x >= 0 && x < slice.rows) countRow(slice.row(src, x), slice.row(dst, x), slice.columns, slice.firstRow + x, statistics[t - 1]);
+    }
+}
+
+/**
+ * @brief Advances the slice by several generations after one halo exchange (temporal blocking).
+ *        Generation t is computed on the rows [lo(t), hi(t)), which shrink by one row per generation on every side with
+ *        a neighbour, because the outermost ghost row gets invalid. On the side of a wall the range stays fixed.
+ *        The rows are split into tiles of `tileRows` rows. Every tile is advanced all the generations before moving
+ *        to the next one, and the tile of generation t is shifted t-1 rows up (time skewing), so it only needs rows
+ *        that were already computed, while the tile is still in the cache. Planes are swapped after every generation.
+ *        When the halo exchange overlaps the computation, the block is computed in two parts: the interior, which needs
+ *        no ghost rows and leaves the sent rows untouched, while the rows are in flight, then the boundary rows.
+ *        The interior of generation t are the rows [depth + t, rows - depth - t) (the whole range on the side of a wall).
+ * @param slice Slice of the process, its ghost rows contain the neighbouring rows.
+ * @param plane Plane with the current generation.
+ * @param steps Number of generations to compute (at most the number of ghost rows).
+ * @param wallTop True if there is no slice above (first process with solid walls).
+ * @param wallBottom True if there is no slice below (last process with solid walls).
+ * @param tileRows Number of rows in one tile.
+ * @param kernel Kernel computing the rows.
+ * @param statistics Statistics of the generations of the block (own rows only), if they are collected.
+ * @param region Rows to compute (whole range, interior or boundary).
+ * @param pending Requests of the halo exchange in flight, tested after every tile so that MPI progresses them (null if none).
+ * @return Plane with the new generation.
+*/
+template <bool Collect>
+int advanceBlock(Slice &slice, int plane, int steps, bool wallTop, bool wallBottom, int tileRows, RowKernel kernel, Statistics *statistics,
+                 Region region, MPI_Request *pending)
+{
+    if (region == BOUNDARY)
+    {
+        for (int t = 1; t <= steps; t++) // For each generation of the block
+        {
+            int lo = wallTop ? 0 : -(steps - t); // Valid rows of generation t
+            int hi = wallBottom ? slice.rows : slice.rows + steps - t;
+            int top = wallTop ? 0 : steps + t; // Interior rows of generation t
+            int bottom = wallBottom ? slice.rows : slice.rows - steps - t;
+            if (top >= bottom) computeRows<Collect>(slice, plane, t, lo, hi, kernel, statistics); // No interior
+            else
+            {
+                computeRows<Collect>(slice, plane, t, lo, top, kernel, statistics);
+                computeRows<Collect>(slice, plane, t, bottom, hi, kernel, statistics);
+            }
+        }
+        return (plane + steps) % 2;
+    }
+
+    int lowest = wallTop ? 0 : -(steps - 1); // First row of the first generation
+    int highest = wallBottom ? slice.rows : slice.rows + steps - 1; // Row after the last row of the first generation
+
+    for (int start = lowest; start < highest; start += tileRows) // For each tile (start is in rows of the first generation)
+    {
+        bool first = start == lowest;
+        bool last = start + tileRows >= highest;
+
+        for (int t = 1; t <= steps; t++) // For each generation of the block
+        {
+            int lo = wallTop ? 0 : -(steps - t); // Valid rows of generation t
+            int hi = wallBottom ? slice.rows : slice.rows + steps - t;
+            if (region == INTERIOR)
+            {
+                lo = wallTop ? 0 : steps + t;
+                hi = wallBottom ? slice.rows : slice.rows - steps - t;
+            }
+            int from = first ? lo : max(lo, start - (t - 1)); // Rows of the tile shifted up by t-1 rows
+            int to = last ? hi : min(hi, start + tileRows - (t - 1));
+            computeRows<Collect>(slice, plane, t, from, to, kernel, statistics);
+        }
+        if (pending)
+        {
+            int done;
+            MPI_Testall(4, pending, &done, MPI_STATUSES_IGNORE);
+        }
+    }
+    return (plane + steps) % 2;
+}
+
+/**
+ * @brief Returns the number of rows in one tile, so that both planes of the tile fit into the L2 cache.
+ * @param options Options of the program.
+ * @param columns Number of columns of the board.
+ * @return Number of rows in one tile.
+*/
+int tileRowsFor(const Options &options, int columns)
+{
+    if (options.tileRows > 0) return options.tileRows;
+    long cacheBytes = sysconf(_SC_LEVEL2_CACHE_SIZE); // Size of the L2 cache (0 or -1 if not known)
+    if (cacheBytes <= 0) cacheBytes = DEFAULT_L2_BYTES;
+    return max(1L, cacheBytes / (2L * (columns + 2) * (long)sizeof(Cell))); // Two planes of the tile (with the ghost columns)
+}
+
+/**
+ * @brief Encodes halo rows by the smallest encoding: an empty marker, the indices of the living cells or a bitmap.
+ * @param rows Rows to encode (cells 0 or 1).
+ * @param count Number of cells of the rows.
+ * @param out Encoded rows, at least 1 + (count + 7) / 8 bytes.
+ * @return Number of bytes of the encoded rows.
+*/
+int encodeRows(const Cell *rows, int count, uint8_t *out)
+{
+    int living = 0; // Number of living cells
+    for (int i = 0; i < count; i++) living += rows[i];
+
+    int bitmap = 1 + (count + 7) / 8; // Size of the bitmap encoding
+    if (living == 0)
+    {
+        out[0] = EMPTY;
+        return 1;
+    }
+    if (1 + 4 * (long)living < bitmap)
+    {
+        out[0] = SPARSE;
+        uint8_t *index = out + 1;
+        for (uint32_t i = 0; i < (uint32_t)count; i++)
+        {
+            if (!rows[i]) continue;
+            memcpy(index, &i, sizeof(i));
+            index += sizeof(i);
+        }
+        return index - out;
+    }
+    out[0] = BITMAP;
+    for (int i = 0; i < count; i += 8)
+    {
+        uint8_t bits = 0;
+        for (int j = 0; j < 8 && i + j < count; j++) bits |= rows[i + j] << j;
+        out[1 + i / 8] = bits;
+    }
+    return bitmap;
+}
+
+/**
+ * @brief Decodes encoded halo rows straight into the ghost rows.
+ * @param in Encoded rows.
+ * @param size Number of bytes of the encoded rows.
+ * @param rows Ghost rows.
+ * @param count Number of cells of the rows.
+ * @return void
+*/
+void decodeRows(const uint8_t *in, int size, Cell *rows, int count)
+{
+    if (in[0] == BITMAP)
+    {
+        for (int i = 0; i < count; i++) rows[i] = (in[1 + i / 8] >> (i % 8)) & 1;
+        return;
+    }
+    memset(rows, 0, count);
+    for (const uint8_t *index = in + 1; in[0] == SPARSE && index < in + size; index += sizeof(uint32_t))
+    {
+        uint32_t i;
+        memcpy(&i, index, sizeof(i));
+        rows[i] = 1;
+    }
+}
+
+/**
+ * @brief Exchange of the ghost rows of the slices over the cartesian communicator of the slices.
+ */
+struct HaloExchange
+{
+    Transport transport = SENDRECV; // Transport of the ghost rows
+    MPI_Comm comm = MPI_COMM_NULL; // Cartesian communicator of the slices
+    int above = MPI_PROC_NULL, below = MPI_PROC_NULL; // Ranks of the neighbours (MPI_PROC_NULL behind a wall)
+    MPI_Win window = MPI_WIN_NULL; // Window over both planes of the slice (RMA and shared only)
+    MPI_Group neighbours = MPI_GROUP_NULL; // Group of the neighbours, the origins and targets of the epochs (RMA only)
+    int shape[2][2] = {}; // Number of rows and ghost rows of the slices above and below (RMA and shared only)
+    MPI_Comm nodeComm = MPI_COMM_NULL; // Processes on the same node (shared only)
+    Cell *local[2] = {}; // Slices of the neighbours above and below on the same node (shared only, null on another node)
+    int remote[2] = {MPI_PROC_NULL, MPI_PROC_NULL}; // Neighbours above and below on other nodes (shared only)
+    vector<uint8_t> encoded, received; // Encoded rows sent and received (compressed only)
+    vector<Cell> lastSent[2], lastReceived[2]; // Rows last sent to and received from the neighbours below and above (compressed only)
+    Progress progress = BLOCKING; // Overlap of the exchange with the computation
+    MPI_Request requests[4] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL}; // Exchange in flight
+    thread progressThread; // Thread testing the requests in flight, waiting between the exchanges (progress thread only)
+    mutex progressMutex; // Guards the state of the progress thread below
+    condition_variable progressWake; // Signals a new exchange to the progress thread and its end to the computing thread
+    bool testing = false; // The progress thread owns the requests in flight
+    bool quit = false; // The progress thread exits
+    atomic<bool> stop{false}; // The computing thread needs the ghost rows, the progress thread stops testing
+
+    /**
+     * @brief Prepares the exchange. A periodic dimension with one or two processes has the same process as both
+     *        neighbours, the neighbourhood collective cannot tell its two messages apart then, so MPI_Sendrecv is used.
+     *        For RMA the whole slice is exposed in a window and the shapes of the neighbouring slices are gathered,
+     *        so the ghost rows of a neighbour can be addressed in its window (a single process uses MPI_Sendrecv).
+     *        For shared memory the slice is moved to a window shared by the processes of the node.
+     * @param transport Requested transport.
+     * @param progress Overlap of the exchange with the computation.
+     * @param comm Cartesian communicator of the slices.
+     * @param slice Slice of the process (allocated).
+     * @return void
+     */
+    void open(Transport transport, Progress progress, MPI_Comm comm, Slice &slice)
+    {
+        this->transport = transport;
+        this->progress = progress;
+        this->comm = comm;
+        MPI_Cart_shift(comm, 0, 1, &above, &below);
+        if (transport == NEIGHBOR && above == below && above != MPI_PROC_NULL) this->transport = SENDRECV;
+        int size;
+        MPI_Comm_size(comm, &size);
+        if (transport == RMA && size == 1) this->transport = SENDRECV; // Nothing to put into another process
+        if (progress == THREAD) progressThread = thread(&HaloExchange::driveProgress, this);
+        if (this->transport != RMA && this->transport != SHARED) return;
+
+        int own[2] = {slice.rows, slice.halo};
+        MPI_Neighbor_allgather(own, 2, MPI_INT, shape, 2, MPI_INT, comm); // Above first, then below
+        if (this->transport == SHARED)
+        {
+            openShared(slice);
+            return;
+        }
+        MPI_Win_create(slice.cells, slice.size, 1, MPI_INFO_NULL, comm, &window);
+
+        vector<int> ranks; // Distinct neighbours (both are the same process in a periodic dimension of one or two processes)
+        if (above != MPI_PROC_NULL) ranks.push_back(above);
+        if (below != MPI_PROC_NULL && below != above) ranks.push_back(below);
+        MPI_Group group;
+        MPI_Comm_group(comm, &group);
+        MPI_Group_incl(group, ranks.size(), ranks.data(), &neighbours);
+        MPI_Group_free(&group);
+    }
+
+    /**
+     * @brief Moves the slice to a window shared by the processes of the node and finds the slices of the neighbours on the node.
+     * @param slice Slice of the process (allocated).
+     * @return void
+     */
+    void openShared(Slice &slice)
+    {
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+        Cell *memory; // Own part of the shared window
+        MPI_Info info; // Every part starts on its own page, so it is touched first by its owner (on its NUMA node) when the slice is moved
+        MPI_Info_create(&info);
+        MPI_Info_set(info, "alloc_shared_noncontig", "true");
+        MPI_Win_allocate_shared(slice.size, 1, info, nodeComm, &memory, &window);
+        MPI_Info_free(&info);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, window); // Passive epoch for the memory barriers of MPI_Win_sync
+        slice.moveTo(memory);
+
+        MPI_Group group, nodeGroup;
+        MPI_Comm_group(comm, &group);
+        MPI_Comm_group(nodeComm, &nodeGroup);
+        int ranks[2] = {above, below}, nodeRanks[2]; // Neighbours and their ranks on the node (MPI_UNDEFINED on another node)
+        MPI_Group_translate_ranks(group, 2, ranks, nodeGroup, nodeRanks);
+        for (int i = 0; i < 2; i++)
+        {
+            if (nodeRanks[i] == MPI_UNDEFINED || nodeRanks[i] == MPI_PROC_NULL) remote[i] = ranks[i];
+            else
+            {
+                MPI_Aint size;
+                int unit;
+                MPI_Win_shared_query(window, nodeRanks[i], &size, &unit, &local[i]);
+            }
+        }
+        MPI_Group_free(&group);
+        MPI_Group_free(&nodeGroup);
+    }
+
+    /**
+     * @brief Exchanges empty messages with the neighbours on the same node, so the process waits only for its two neighbours
+     *        instead of all processes of the node (shared only).
+     * @param tag Tag of the messages.
+     * @return void
+     */
+    void handshake(int tag)
+    {
+        MPI_Request handshakes[4];
+        int count = 0;
+        int ranks[2] = {above, below};
+        for (int i = 0; i < 2; i++)
+        {
+            if (!local[i]) continue; // Messages of the neighbours on other nodes synchronise the exchange with them
+            MPI_Irecv(nullptr, 0, MPI_BYTE, ranks[i], tag, comm, &handshakes[count++]);
+            MPI_Isend(nullptr, 0, MPI_BYTE, ranks[i], tag, comm, &handshakes[count++]);
+        }
+        MPI_Waitall(count, handshakes, MPI_STATUSES_IGNORE);
+    }
+
+    /**
+     * @brief Returns the displacement of a row in the window of a neighbour.
+     * @param neighbour Neighbour (0 above, 1 below).
+     * @param plane Plane of the slice.
+     * @param row Index of the row within the slice of the neighbour.
+     * @param stride Number of cells of a stored row (the same for all slices).
+     * @return Displacement of the first ghost column of the row in bytes.
+     */
+    MPI_Aint remoteRow(int neighbour, int plane, int row, int stride) const
+    {
+        int rows = shape[neighbour][0], halo = shape[neighbour][1];
+        return ((MPI_Aint)plane * (rows + 2 * halo) + row + halo) * stride;
+    }
+
+    /**
+     * @brief Body of the progress thread of the process. It sleeps until an exchange starts, then tests its requests
+     *        until they complete or the computing thread needs them, and reports that it no longer calls MPI.
+     * @return void
+     */
+    void driveProgress()
+    {
+        unique_lock<mutex> lock(progressMutex);
+        while (true)
+        {
+            progressWake.wait(lock, [this] { return testing || quit; });
+            if (quit) return;
+            lock.unlock();
+            int done = 0;
+            while (!done && !stop)
+            {
+                MPI_Testall(4, requests, &done, MPI_STATUSES_IGNORE);
+                if (!done) this_thread::yield();
+            }
+            lock.lock();
+            testing = false;
+            progressWake.notify_all();
+        }
+    }
+
+    /**
+     * @brief Stops the progress thread and frees the window, the group and the node communicator
+     *        (the slice in a shared window is freed with it).
+     * @return void
+     */
+    void close()
+    {
+        if (progressThread.joinable())
+        {
+            {
+                lock_guard<mutex> lock(progressMutex);
+                quit = true;
+            }
+            progressWake.notify_all();
+            progressThread.join();
+        }
+        if (nodeComm != MPI_COMM_NULL) MPI_Win_unlock_all(window);
+        if (window != MPI_WIN_NULL) MPI_Win_free(&window);
+        if (neighbours != MPI_GROUP_NULL) MPI_Group_free(&neighbours);
+        if (nodeComm != MPI_COMM_NULL) MPI_Comm_free(&nodeComm);
+    }
+
+    /**
+     * @brief Sends the first and last rows of the slice to the neighbours by messages and receives theirs straight into the ghost rows.
+     * @param slice Slice of the process.
+     * @param plane Plane with the current generation.
+     * @param steps Number of rows exchanged in each direction.
+     * @param up Neighbour above (MPI_PROC_NULL for none).
+     * @param down Neighbour below (MPI_PROC_NULL for none).
+     * @return Number of bytes sent.
+     */
+    long long sendRecvRows(Slice &slice, int plane, int steps, int up, int down)
+    {
+        int count = steps * slice.stride; // Number of cells sent to each neighbour (rows with their ghost columns)
+
+        // Every processor sends its last rows to the processor under it and receives the last rows of the processor above it,
+        // straight into its ghost rows (nothing is sent or received behind a wall, MPI_PROC_NULL)
+        MPI_Sendrecv(slice.paddedRow(plane, slice.rows - steps), count, MPI_UNSIGNED_CHAR, down, 3,
+                     slice.paddedRow(plane, -steps), count, MPI_UNSIGNED_CHAR, up, 3, comm, MPI_STATUS_IGNORE);
+
+        // Every processor sends its first rows to the processor above it and receives the first rows of the processor under it
+        MPI_Sendrecv(slice.paddedRow(plane, 0), count, MPI_UNSIGNED_CHAR, up, 4,
+                     slice.paddedRow(plane, slice.rows), count, MPI_UNSIGNED_CHAR, down, 4, comm, MPI_STATUS_IGNORE);
+        return (long long)count * ((up != MPI_PROC_NULL) + (down != MPI_PROC_NULL));
+    }
+
+    /**
+     * @brief Sends the encoded first and last rows of the slice to the neighbours and decodes theirs straight into the ghost rows.
+     *        The receiver does not know the size of the encoding, so it receives up to the size of the bitmap.
+     *        Rows that are the same as the rows last sent in that direction are sent as a one byte token, the receiver
+     *        restores them from its copy (the ghost rows themselves were overwritten by the trapezoid of the previous block).
+     * @param slice Slice of the process.
+     * @param plane Plane with the current generation.
+     * @param steps Number of rows exchanged in each direction.
+     * @return Number of bytes sent.
+     */
+    long long sendRecvEncoded(Slice &slice, int plane, int steps)
+    {
+        int count = steps * slice.stride; // Number of cells of the rows sent to each neighbour
+        int capacity = 1 + (count + 7) / 8; // Size of the largest encoding
+        encoded.resize(capacity);
+        received.resize(capacity);
+        long long bytes = 0;
+
+        // Last rows to the processor under it, first rows to the processor above it (as by the two MPI_Sendrecv calls)
+        Cell *sent[2] = {slice.paddedRow(plane, slice.rows - steps), slice.paddedRow(plane, 0)};
+        Cell *ghost[2] = {slice.paddedRow(plane, -steps), slice.paddedRow(plane, slice.rows)};
+        int destination[2] = {below, above}, source[2] = {above, below};
+        for (int i = 0; i < 2; i++)
+        {
+            int size = 0; // Size of the encoded rows
+            if (destination[i] != MPI_PROC_NULL && lastSent[i].size() == (size_t)count && memcmp(lastSent[i].data(), sent[i], count) == 0)
+            {
+                encoded[0] = UNCHANGED;
+                size = 1;
+            }
+            else if (destination[i] != MPI_PROC_NULL)
+            {
+                size = encodeRows(sent[i], count, encoded.data());
+                lastSent[i].assign(sent[i], sent[i] + count);
+            }
+            MPI_Status status;
+            MPI_Sendrecv(encoded.data(), size, MPI_UNSIGNED_CHAR, destination[i], 3 + i,
+                         received.data(), capacity, MPI_UNSIGNED_CHAR, source[i], 3 + i, comm, &status);
+            if (source[i] != MPI_PROC_NULL)
+            {
+                int got;
+                MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &got);
+                if (received[0] == UNCHANGED) copy(lastReceived[i].begin(), lastReceived[i].end(), ghost[i]);
+                else
+                {
+                    decodeRows(received.data(), got, ghost[i], count);
+                    lastReceived[i].assign(ghost[i], ghost[i] + count);
+                }
+            }
+            bytes += size;
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Starts the non-blocking exchange of the first and last rows of the slice, straight from and into the slice.
+     *        The sent rows must not be overwritten and the ghost rows not read until end() is called.
+     * @param slice Slice of the process.
+     * @param plane Plane with the current generation.
+     * @param steps Number of rows exchanged in each direction.
+     * @return Number of bytes sent to the neighbours.
+     */
+    long long begin(Slice &slice, int plane, int steps)
+    {
+        int count = steps * slice.stride; // Number of cells sent to each neighbour (rows with their ghost columns)
+        MPI_Irecv(slice.paddedRow(plane, -steps), count, MPI_UNSIGNED_CHAR, above, 3, comm, &requests[0]);
+        MPI_Irecv(slice.paddedRow(plane, slice.rows), count, MPI_UNSIGNED_CHAR, below, 4, comm, &requests[1]);
+        MPI_Isend(slice.paddedRow(plane, slice.rows - steps), count, MPI_UNSIGNED_CHAR, below, 3, comm, &requests[2]);
+        MPI_Isend(slice.paddedRow(plane, 0), count, MPI_UNSIGNED_CHAR, above, 4, comm, &requests[3]);
+
+        if (progress == THREAD)
+        {
+            // The computing thread makes no MPI call until end() (the profiler reads the steady clock),
+            // so the progress thread is the only one calling MPI meanwhile
+            {
+                lock_guard<mutex> lock(progressMutex);
+                stop = false;
+                testing = true;
+            }
+            progressWake.notify_all();
+        }
+        return (long long)count * ((above != MPI_PROC_NULL) + (below != MPI_PROC_NULL));
+    }
+
+    /**
+     * @brief Returns the requests to be tested by the computing thread (null if there is nothing to test).
+     * @return Requests of the exchange in flight.
+     */
+    MPI_Request *pending()
+    {
+        return progress == POLL ? requests : nullptr;
+    }
+
+    /**
+     * @brief Completes the non-blocking exchange, the ghost rows are valid afterwards.
+     * @return void
+     */
+    void end()
+    {
+        if (progress == THREAD)
+        {
+            stop = true;
+            unique_lock<mutex> lock(progressMutex);
+            progressWake.wait(lock, [this] { return !testing; }); // The progress thread makes no more MPI calls
+        }
+        MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+    }
+
+    /**
+     * @brief Sends the first and last rows of the slice to the neighbours and receives theirs straight into the ghost rows.
+     * @param slice Slice of the process.
+     * @param plane Plane with the current generation.
+     * @param steps Number of rows exchanged in each direction.
+     * @return Number of bytes sent (or copied) to the neighbours.
+     */
+    long long exchange(Slice &slice, int plane, int steps)
+    {
+        int count = steps * slice.stride; // Number of cells sent to each neighbour (rows with their ghost columns)
+        long long bytes = (long long)count * ((above != MPI_PROC_NULL) + (below != MPI_PROC_NULL)); // Bytes of the uncompressed rows
+        if (transport == COMPRESSED) return sendRecvEncoded(slice, plane, steps);
+        if (transport == NEIGHBOR)
+        {
+            // Neighbours of a cartesian dimension are ordered as the one above (-1) and the one below (+1),
+            // the blocks are given by their displacement in bytes from the beginning of the slice
+            Cell *base = slice.cells;
+            int counts[2] = {count, count};
+            MPI_Aint sendDispls[2] = {slice.paddedRow(plane, 0) - base, slice.paddedRow(plane, slice.rows - steps) - base};
+            MPI_Aint recvDispls[2] = {slice.paddedRow(plane, -steps) - base, slice.paddedRow(plane, slice.rows) - base};
+            MPI_Datatype types[2] = {MPI_UNSIGNED_CHAR, MPI_UNSIGNED_CHAR};
+            MPI_Neighbor_alltoallw(base, counts, sendDispls, types, base, counts, recvDispls, types, comm);
+            return bytes;
+        }
+        if (transport == RMA)
+        {
+            // The exposure epoch is posted only after the own compute of the previous block has finished, so the neighbours
+            // cannot overwrite ghost rows that are still read. Every process puts its last rows into the upper ghost rows
+            // of the process under it and its first rows into the lower ghost rows of the process above it.
+            MPI_Win_post(neighbours, 0, window);
+            MPI_Win_start(neighbours, 0, window);
+            if (below != MPI_PROC_NULL) MPI_Put(slice.paddedRow(plane, slice.rows - steps), count, MPI_UNSIGNED_CHAR,
+                                                below, remoteRow(1, plane, -steps, slice.stride), count, MPI_UNSIGNED_CHAR, window);
+            if (above != MPI_PROC_NULL) MPI_Put(slice.paddedRow(plane, 0), count, MPI_UNSIGNED_CHAR,
+                                                above, remoteRow(0, plane, shape[0][0], slice.stride), count, MPI_UNSIGNED_CHAR, window);
+            MPI_Win_complete(window);
+            MPI_Win_wait(window);
+            return bytes;
+        }
+        if (transport == SHARED)
+        {
+            // The neighbours on the node have computed the previous block after the handshake, then their boundary rows are copied
+            // straight from their slices, only the neighbours on other nodes send messages. The ghost rows have to be private
+            // copies, because the trapezoid of the temporal blocking computes them further.
+            MPI_Win_sync(window);
+            handshake(6);
+            MPI_Win_sync(window);
+            if (local[0]) memcpy(slice.paddedRow(plane, -steps), local[0] + remoteRow(0, plane, shape[0][0] - steps, slice.stride), count);
+            if (local[1]) memcpy(slice.paddedRow(plane, slice.rows), local[1] + remoteRow(1, plane, 0, slice.stride), count);
+            sendRecvRows(slice, plane, steps, remote[0], remote[1]);
+            handshake(7); // The rows of the neighbours are not overwritten by the next block until they are copied
+            return bytes;
+        }
+
+        return sendRecvRows(slice, plane, steps, above, below);
+    }
+};
+
+/**
+ * @brief Stream of the statistics of the generations. The statistics of a block of generations are combined over
+ *        all processes by non-blocking reductions, which complete while the next block is computed,
+ *        then the root appends them to a CSV file.
+ */
+struct StatisticsStream
+{
+    static const int SUMS = 3; // Population, births and deaths (summed)
+    static const int CORNERS = 4; // Bounding box (minimum of the top left corner and of the negated bottom right corner)
+
+    FILE *file = nullptr; // Output file (root only)
+    MPI_Comm comm = MPI_COMM_NULL; // Communicator of all processes
+    int rank = 0; // Rank of the process
+    int first = 0; // First generation of the pending block
+    int count = 0; // Number of generations of the pending block (0 if there is none)
+    vector<long long> sums, reducedSums; // Sums of the generations of the pending block
+    vector<int> corners, reducedCorners; // Corners of the bounding boxes of the pending block
+    MPI_Request requests[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL}; // Pending reductions
+
+    /**
+     * @brief Opens the stream, the root creates the file with the header.
+     * @param name Name of the file.
+     * @param rank Rank of the process.
+     * @param comm Communicator of all processes.
+     * @return void
+     */
+    void open(const string &name, int rank, MPI_Comm comm)
+    {
+        this->rank = rank;
+        this->comm = comm;
+        if (rank != MASTER) return;
+        file = fopen(name.c_str(), "w");
+        if (!file)
+        {
+            cerr << "Error opening file for statistics" << endl;
+            MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+        }
+        fprintf(file, "generation,population,births,deaths,min_row,min_column,max_row,max_column\n");
+    }
+
+    /**
+     * @brief Starts the reduction of the statistics of a block, the previous block is written first.
+     * @param statistics Statistics of the generations of the block of this process.
+     * @param generations Number of generations of the block.
+     * @param firstGeneration Number of the first generation of the block.
+     * @return void
+     */
+    void submit(const Statistics *statistics, int generations, int firstGeneration)
+    {
+        flush();
+        sums.resize(SUMS * generations);
+        corners.resize(CORNERS * generations);
+        reducedSums.resize(sums.size());
+        reducedCorners.resize(corners.size());
+        for (int t = 0; t < generations; t++)
+        {
+            const Statistics &s = statistics[t];
+            long long *sum = &sums[SUMS * t];
+            int *corner = &corners[CORNERS * t];
+            sum[0] = s.population;
+            sum[1] = s.births;
+            sum[2] = s.deaths;
+            corner[0] = s.minRow;
+            corner[1] = s.minColumn;
+            corner[2] = -s.maxRow; // Maximum is the negated minimum of the negated values
+            corner[3] = -s.maxColumn;
+        }
+        MPI_Ireduce(sums.data(), reducedSums.data(), sums.size(), MPI_LONG_LONG, MPI_SUM, MASTER, comm, &requests[0]);
+        MPI_Ireduce(corners.data(), reducedCorners.data(), corners.size(), MPI_INT, MPI_MIN, MASTER, comm, &requests[1]);
+        first = firstGeneration;
+        count = generations;
+    }
+
+    /**
+     * @brief Waits for the reductions of the pending block and the root writes its generations into the file.
+     * @return void
+     */
+    void flush()
+    {
+        if (count == 0) return;
+        MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+        for (int t = 0; file && t < count; t++)
+        {
+            const long long *sum = &reducedSums[SUMS * t];
+            const int *corner = &reducedCorners[CORNERS * t];
+            if (sum[0] == 0) fprintf(file, "%d,0,%lld,%lld,-1,-1,-1,-1\n", first + t, sum[1], sum[2]);
+            else fprintf(file, "%d,%lld,%lld,%lld,%d,%d,%d,%d\n", first + t, sum[0], sum[1], sum[2], corner[0], corner[1], -corner[2], -corner[3]);
+        }
+        count = 0;
+    }
+
+    /**
+     * @brief Writes the pending block and closes the file.
+     * @return void
+     */
+    void close()
+    {
+        flush();
+        if (file) fclose(file);
+        file = nullptr;
+    }
+};
+
+/**
+ * @brief Incremental engine for boards with little activity. A cell can change only if it or one of its neighbours changed
+ *        in the previous generation, so only those cells are evaluated. The number of living neighbours of every own cell
+ *        is kept in an array updated by every birth and death, instead of summing the 8 neighbours again. The ghost rows
+ *        are compared with their previous contents after the exchange, their changes update the counts of the edge rows.
+ *        The cells live in plane 0 of the slice with one ghost row on each side.
+ */
+struct ChangeList
+{
+    int rows = 0; // Number of own rows of the slice
+    int columns = 0; // Number of columns of the board
+    bool torus = false; // Columns wrap around
+    unsigned birth = 0, survival = 0; // Masks of the rule
+    vector<uint8_t> counts; // Living neighbours of every own cell (index x * columns + y)
+    vector<uint8_t> queued; // The cell is a candidate of the next generation
+    vector<int> candidates; // Cells evaluated in the next generation
+    vector<int> changes; // Cells changing in the current generation
+    vector<Cell> ghosts[2]; // Ghost rows above and below as they were in the previous generation
+
+    /**
+     * @brief Counts the neighbours within the own rows, the ghost rows are dead until the first exchange changes them.
+     *        All cells are candidates of the first generation.
+     * @param slice Slice of the process (loaded, one ghost row on each side).
+     * @param options Options of the program.
+     * @return void
+     */
+    void open(Slice &slice, const Options &options)
+    {
+        rows = slice.rows;
+        columns = slice.columns;
+        torus = slice.torus;
+        birth = options.birth;
+        survival = options.survival;
+        counts.assign((size_t)rows * columns, 0);
+        queued.assign((size_t)rows * columns, 1);
+        candidates.resize((size_t)rows * columns);
+        for (int cell = 0; cell < rows * columns; cell++) candidates[cell] = cell;
+        for (int i = 0; i < 2; i++) ghosts[i].assign(columns, 0);
+        for (int x = 0; x < rows; x++)
+        {
+            const Cell *cells = slice.row(0, x);
+            for (int y = 0; y < columns; y++) if (cells[y]) changeNeighbours(x, y, 1, false);
+        }
+    }
+
+    /**
+     * @brief Adds a change of a cell to the counts of its neighbours in the own rows and queues them.
+     * @param x Row of the cell within the slice (-1 and rows are the ghost rows).
+     * @param y Column of the cell.
+     * @param delta +1 for a birth, -1 for a death.
+     * @param queue Queue the cell and its neighbours as candidates.
+     * @return void
+     */
+    void changeNeighbours(int x, int y, int delta, bool queue)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            if (x + dx < 0 || x + dx >= rows) continue; // Counts of the ghost rows are kept by the neighbours
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                int column = y + dy;
+                if (torus) column = (column + columns) % columns;
+                else if (column < 0 || column >= columns) continue; // Behind a wall
+                int cell = (x + dx) * columns + column;
+                if (dx != 0 || dy != 0) counts[cell] += delta;
+                if (queue && !queued[cell])
+                {
+                    queued[cell] = 1;
+                    candidates.push_back(cell);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Applies the changes of a received ghost row since the previous generation to the counts of the edge row.
+     * @param slice Slice of the process.
+     * @param x Ghost row (-1 or rows).
+     * @param previous Previous contents of the ghost row, updated.
+     * @return void
+     */
+    void ghostChanges(Slice &slice, int x, vector<Cell> &previous)
+    {
+        const Cell *cells = slice.row(0, x);
+        if (memcmp(cells, previous.data(), columns) == 0) return;
+        for (int y = 0; y < columns; y++)
+        {
+            if (cells[y] == previous[y]) continue;
+            changeNeighbours(x, y, cells[y] ? 1 : -1, true);
+            previous[y] = cells[y];
+        }
+    }
+
+    /**
+     * @brief Advances the own rows by one generation, the ghost rows contain the current generation of the neighbours.
+     *        All candidates are evaluated before any cell changes, then the changes update the counts and the candidates.
+     * @param slice Slice of the process.
+     * @return void
+     */
+    void advance(Slice &slice)
+    {
+        ghostChanges(slice, -1, ghosts[0]);
+        ghostChanges(slice, rows, ghosts[1]);
+
+        changes.clear();
+        for (int cell : candidates)
+        {
+            queued[cell] = 0;
+            Cell state = slice.row(0, cell / columns)[cell % columns];
+            if ((((state ? survival : birth) >> counts[cell]) & 1) != state) changes.push_back(cell);
+        }
+        candidates.clear();
 
-const int COLUMNS = 0; // Index of the number of columns in the message vector
-const int SLICEROWS = 1; // Index of the number of slice rows in the message vector
-const int GENERATIONS = 2; // Index of the number of generations in the message vector
+        for (int cell : changes)
+        {
+            int x = cell / columns, y = cell % columns;
+            Cell &state = slice.row(0, x)[y];
+            state ^= 1;
+            changeNeighbours(x, y, state ? 1 : -1, true);
+            if (y == 0 || y == columns - 1) slice.wrapColumns(0, x);
+        }
+    }
+};
 
 /**
- * @brief Function for root process (rank = 0), that reads the board from the file and sends the slices to all other processes including itself.
+ * @brief Reduces the times of the phases of all processes to their minimum, mean and maximum,
+ *        the root prints them as a JSON object to the standard error output.
+ * @param profiler Profiler of the process.
  * @param size Number of processes.
  * @param rank Rank of the process.
- * @param argc Number of command-line arguments.
- * @param argv Array of command-line arguments.
+ * @param comm Communicator of all processes.
  * @return void
 */
-void processRoot(int size, int rank, int argc, char *argv[])
+void reportProfile(const Profiler &profiler, int size, int rank, MPI_Comm comm)
 {
+    const int LOOP = PHASES, TOTAL = PHASES + 1, BYTES = PHASES + 2; // Indices of the values after the phases
+    const int VALUES = PHASES + 3; // Phases, time of the generations loop, total time and halo bytes
+    double values[VALUES], minimum[VALUES], maximum[VALUES], sum[VALUES];
+
+    double total = 0;
+    for (int phase = 0; phase < PHASES; phase++) total += values[phase] = profiler.time[phase];
+    values[LOOP] = total - profiler.time[INPUT] - profiler.time[OUTPUT]; // Generations only, without the input and output
+    values[TOTAL] = total;
+    values[BYTES] = profiler.haloBytes;
 
-    ifstream file(argv[1]); // Input file
-    int generations = atoi(argv[2]); // Number of steps to simulate
+    MPI_Reduce(values, minimum, VALUES, MPI_DOUBLE, MPI_MIN, MASTER, comm);
+    MPI_Reduce(values, maximum, VALUES, MPI_DOUBLE, MPI_MAX, MASTER, comm);
+    MPI_Reduce(values, sum, VALUES, MPI_DOUBLE, MPI_SUM, MASTER, comm);
+    if (rank != MASTER) return;
 
-    if (!file)
+    // Prints one value as {"min": .., "mean": .., "max": ..}
+    auto print = [&](const char *name, int i, bool last)
     {
-        cerr << "Error opening file (Try checking the name of file)" << endl;
-        cerr << "Usage: ./test.sh <input file> <number of generations>" << endl;
-        MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+        fprintf(stderr, "    \"%s\": {\"min\": %.6f, \"mean\": %.6f, \"max\": %.6f}%s\n", name, minimum[i], sum[i] / size, maximum[i], last ? "" : ",");
+    };
+
+    fprintf(stderr, "{\n  \"ranks\": %d,\n  \"seconds\": {\n", size);
+    for (int phase = 0; phase < PHASES; phase++) print(PHASE_NAMES[phase], phase, false);
+    print("loop", LOOP, false);
+    print("total", TOTAL, true);
+    fprintf(stderr, "  },\n  \"bytes\": {\n");
+    print("halo", BYTES, true);
+    fprintf(stderr, "  }\n}\n");
+}
+
+/**
+ * @brief Function that processes the generations of the game of life with all processors using the slices of the board.
+ *        The halo of `depth` rows is exchanged once per `depth` generations, then the slice is advanced by them.
+ *        The processes form a cartesian communicator of the rows, which is periodic for the torus.
+ * @param size Number of processes.
+ * @param rank Rank of the process.
+ * @param options Options of the program.
+ * @return void
+*/
+void generationsLoop(int size, int rank, const Options &options) {
+
+    // Generation 0 of a file is the file itself, it is printed by the root without distributing the board
+    // (the statistics and the profile need the distributed board, so with them the board goes through the loop below)
+    if (options.generations == 0 && options.generator.kind == Generator::NONE && options.statistics.empty() && !options.profile)
+    {
+        printInitialBoard(rank, options);
+        return;
     }
 
-    vector<vector<int>> board; // 2D vector representing the board
-    string line; // Line of the board
+    Slice slice; // Slice of the board owned by this process
+    Profiler profiler; // Time of the phases of this process
+    profiler.enabled = options.profile;
+    profiler.start();
 
-    // Read the board from a file to a 2D vector of integers
-    while (getline(file, line))
+    // Dimensions of the board, generated or read by the root
+    vector<vector<Cell>> board; // Rows of the board (root only, input file only)
+    int dimensions[2] = {options.generator.rows, options.generator.columns};
+    if (options.generator.kind == Generator::NONE)
     {
-        vector<int> row;
-        // '0' have ASCII value of 48 and numbers (1-9) have ASCII values from 49 to 57. This way we convert char to int
-        for (char c : line) row.push_back(c - '0'); 
-        board.push_back(row);
+        if (rank == MASTER)
+        {
+            readInput(options, board);
+            dimensions[ROWS] = board.size();
+            dimensions[COLUMNS] = board[0].size();
+        }
+        MPI_Bcast(dimensions, 2, MPI_INT, MASTER, MPI_COMM_WORLD);
+    }
+    int rows = dimensions[ROWS];
+    int columns = dimensions[COLUMNS];
+
+    // Only the processes chosen by the cost model compute the board, the others are released
+    int active = activeProcesses(size, rows, columns, options);
+    MPI_Comm activeComm; // Communicator of the active processes (MPI_COMM_NULL for the idle ones)
+    MPI_Comm_split(MPI_COMM_WORLD, rank < active ? 0 : MPI_UNDEFINED, rank, &activeComm);
+    if (activeComm == MPI_COMM_NULL) return;
+    if (rank == MASTER && active < size) cerr << "Using " << active << " of " << size << " processes" << endl;
+    size = active;
+
+    int sliceRows = sliceRowsOf(rank, size, rows);
+    int depth = min(options.depth, rows / size); // The same number of ghost rows for all slices, they exchange blocks together
+    if (options.engine == CHANGELIST) depth = 1; // Changes are propagated one generation at a time
+    allocateSlice(slice, sliceRows, columns, depth, options.topology == TORUS);
+    slice.firstRow = firstRowOf(rank, size, rows);
+
+    if (options.generator.kind != Generator::NONE) generateSlice(slice, options.generator, slice.firstRow); // No input and no scatter
+    else if (rank == MASTER) processRoot(size, board, slice, activeComm); // Distribute the board and keep the own slice
+    else
+    {
+        MPI_Datatype rowsType = ownRowsType(slice);
+        MPI_Recv(slice.row(0, 0), 1, rowsType, MASTER, 2, activeComm, MPI_STATUS_IGNORE); // Receive the slice from the root process straight into its rows
+        MPI_Type_free(&rowsType);
+        wrapSlice(slice);
     }
-    file.close();
+    vector<vector<Cell>>().swap(board); // The root does not need the board any more
+
+    int generations = options.generations;
+    int tileRows = tileRowsFor(options, columns);
+    int periodic = options.topology == TORUS; // Last slice is followed by the first one
+    MPI_Comm rowsComm; // Cartesian communicator of the slices
+    MPI_Cart_create(activeComm, 1, &size, &periodic, 0, &rowsComm);
 
-    // In case of 0 generations, print the initial state and exit
-    if (generations == 0)
+    HaloExchange halo; // Exchange of the ghost rows with the processes with the slices above and below
+    halo.open(options.transport, options.progress, rowsComm, slice);
+    int above = halo.above, below = halo.below; // MPI_PROC_NULL behind a wall
+    bool wallTop = above == MPI_PROC_NULL; // First processor with walls has no previous processor, its ghost rows above stay zero
+    bool wallBottom = below == MPI_PROC_NULL; // Last processor with walls has no next processor, its ghost rows below stay zero
+    int plane = 0; // Plane with the current generation
+    RowKernel kernel = selectKernel(options);
+    bool collect = !options.statistics.empty(); // Collect the statistics of the generations
+    vector<Statistics> statistics; // Statistics of the generations of the current block
+    StatisticsStream stream; // Stream of the statistics to the file
+    if (collect) stream.open(options.statistics, rank, rowsComm);
+    bool tracked = !(options.birth & 1) && options.engine == BLOCKS; // Dead areas stay dead unless cells are born with no neighbours (B0)
+    ChangeList changeList; // Changed cells and neighbour counts (change list engine only)
+    if (options.engine == CHANGELIST) changeList.open(slice, options);
+    if (tracked) slice.track();
+    // Measures the living columns of the ghost rows received for this block
+    auto measureGhostRows = [&](int steps)
     {
-        // Print and remove lines from the vector until it'sliceRows empty
-        while (!board.empty())
+        for (int x = 1; x <= steps && tracked; x++)
         {
-            std::cout << rank << ": ";
-            for (int val : board.back()) std::cout << val; // Print all elements of the last row
-            std::cout << endl;
-            board.pop_back(); // Remove the last row
+            slice.measure(plane, -x, 0, columns);
+            slice.measure(plane, slice.rows - 1 + x, 0, columns);
         }
-    } 
-    else if (generations < 0)
+    };
+    profiler.end(INPUT);
+
+    for (int g = 0; g < generations; ) // For each block of generations of the game
     {
-        cerr << "Number of generations must be a non-negative integer" << endl;
-        MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+        int steps = min(slice.halo, generations - g); // Number of generations computed in this block
+        profiler.end(PACK); // The rows are sent straight from the slice (or encoded by the exchange), there is nothing to pack
+
+        if (collect) statistics.assign(steps, Statistics());
+        // Computes a region of the block, with or without the statistics
+        auto advance = [&](Region region, MPI_Request *pending)
+        {
+            if (collect) return advanceBlock<true>(slice, plane, steps, wallTop, wallBottom, tileRows, kernel, statistics.data(), region, pending);
+            return advanceBlock<false>(slice, plane, steps, wallTop, wallBottom, tileRows, kernel, nullptr, region, pending);
+        };
+
+        int next;
+        if (options.engine == CHANGELIST)
+        {
+            profiler.haloBytes += halo.exchange(slice, plane, steps);
+            profiler.end(HALO);
+            changeList.advance(slice);
+            next = plane; // The cells change in place
+        }
+        else if (options.progress == BLOCKING)
+        {
+            profiler.haloBytes += halo.exchange(slice, plane, steps);
+            measureGhostRows(steps);
+            profiler.end(HALO);
+            next = advance(WHOLE, nullptr);
+        }
+        else
+        {
+            // The rows travel while the interior is computed, then the boundary rows are computed from the received ghost rows
+            profiler.haloBytes += halo.begin(slice, plane, steps);
+            profiler.end(HALO);
+            advance(INTERIOR, halo.pending());
+            profiler.end(COMPUTE);
+            halo.end(); // Waiting for a late neighbour is communication
+            profiler.end(HALO);
+            measureGhostRows(steps);
+            next = advance(BOUNDARY, nullptr);
+        }
+        if (collect) stream.submit(statistics.data(), steps, g + 1); // Reduced while the next block is computed
+        profiler.end(COMPUTE);
+
+        plane = next; // The planes are swapped by their index only
+        g += steps;
+        profiler.end(SWAP);
+    }
+
+    // Once the final generation is reached, only the root process will print the board
+    if (rank == 0)
+    {
+        vector<Cell> sliceToPrint((size_t)sliceRows * columns); // Rows of the other slices (the root's slice is the largest)
+        OutputBuffer output(columns, options.prefix);
+        for (int x = 0; x < sliceRows; x++) output.row(rank, slice.row(plane, x), columns); // Print the root's slice
+        for (int i = 1; i < size; i++)
+        {
+            int rowsOfSlice = sliceRowsOf(i, size, rows);
+            MPI_Recv(sliceToPrint.data(), columns * rowsOfSlice, MPI_UNSIGNED_CHAR, i, 5, activeComm, MPI_STATUS_IGNORE); // Receive the slice from the other processors
+            for (int x = 0; x < rowsOfSlice; x++) output.row(i, &sliceToPrint[(size_t)x * columns], columns);
+        }
+    }
+    // As non-root process, send the slice to the root process
+    else
+    {
+        MPI_Datatype rowsType = ownRowsType(slice); // Own rows without the ghost columns, sent straight from the slice
+        MPI_Send(slice.row(plane, 0), 1, rowsType, MASTER, 5, activeComm);
+        MPI_Type_free(&rowsType);
+    }
+    if (collect) stream.close();
+    profiler.end(OUTPUT);
+
+    if (options.profile) reportProfile(profiler, size, rank, rowsComm);
+    halo.close();
+    MPI_Comm_free(&rowsComm);
+    MPI_Comm_free(&activeComm);
+}
+
+/**
+ * @brief Board of the batch mode.
+ */
+struct BatchEntry
+{
+    string board; // Input file of the board
+    int generations = 0; // Number of generations
+    unsigned birth = 0, survival = 0; // Rule of the board
+    string output; // Output file with the final board
+    double cost = 0; // Estimated cost (size of the input file times the generations)
+};
+
+/**
+ * @brief Reads the manifest of the batch mode. Every line is `<board file> <generations> [<rule>] [<output file>]`,
+ *        empty lines and lines starting with '#' are skipped. The rule defaults to the rule of the options
+ *        and the output file to the board file with the suffix `.out`.
+ * @param name Name of the manifest.
+ * @param options Options of the program.
+ * @param entries Boards of the batch.
+ * @return True if the manifest is valid.
+*/
+bool readManifest(const string &name, const Options &options, vector<BatchEntry> &entries)
+{
+    ifstream file(name); // Manifest
+    if (!file) return false;
+
+    string line; // Line of the manifest
+    while (getline(file, line))
+    {
+        vector<string> fields; // Fields of the line separated by white space
+        size_t start = line.find_first_not_of(" \t\r");
+        while (start != string::npos)
+        {
+            size_t end = line.find_first_of(" \t\r", start);
+            fields.push_back(line.substr(start, end == string::npos ? string::npos : end - start));
+            start = end == string::npos ? end : line.find_first_not_of(" \t\r", end);
+        }
+        if (fields.empty() || fields[0][0] == '#') continue;
+        if (fields.size() < 2 || fields.size() > 4) return false;
+
+        BatchEntry entry;
+        entry.board = fields[0];
+        entry.generations = atoi(fields[1].c_str());
+        entry.birth = options.birth;
+        entry.survival = options.survival;
+        if (fields.size() > 2 && !parseRule(fields[2], entry.birth, entry.survival)) return false;
+        entry.output = fields.size() > 3 ? fields[3] : entry.board + ".out";
+        if (entry.generations < 0) return false;
+
+        struct stat info;
+        entry.cost = (stat(entry.board.c_str(), &info) == 0 ? info.st_size : 0) * (double)max(entry.generations, 1);
+        entries.push_back(entry);
     }
+    return true;
+}
 
-    // MxN board of even size
+/**
+ * @brief Simulates a whole board in one process, the same blocks as in the generations loop without any exchange.
+ *        With the torus the ghost rows are copies of the own rows on the other side of the board.
+ * @param board Rows of the board (valid).
+ * @param generations Number of generations.
+ * @param options Options of the program (with the rule of the board).
+ * @param slice Slice for the whole board.
+ * @return Plane with the final generation.
+*/
+int simulateBoard(const vector<vector<Cell>> &board, int generations, const Options &options, Slice &slice)
+{
     int rows = board.size();
     int columns = board[0].size();
-    int sliceRows = rows / size; // Number of rows in a slice (every slice has the same number of rows)
-    int slice[sliceRows][columns]; // Slice of the board
+    bool torus = options.topology == TORUS;
+    allocateSlice(slice, rows, columns, min(options.depth, rows), torus);
+    for (int row = 0; row < rows; row++) copy(board[row].begin(), board[row].end(), slice.row(0, row));
+    wrapSlice(slice);
+
+    RowKernel kernel = selectKernel(options);
+    int tileRows = tileRowsFor(options, columns);
+    int plane = 0; // Plane with the current generation
+    for (int g = 0; g < generations; ) // For each block of generations
+    {
+        int steps = min(slice.halo, generations - g);
+        if (torus) // The board is its own neighbour above and below
+        {
+            memcpy(slice.paddedRow(plane, -steps), slice.paddedRow(plane, rows - steps), (size_t)steps * slice.stride);
+            memcpy(slice.paddedRow(plane, rows), slice.paddedRow(plane, 0), (size_t)steps * slice.stride);
+        }
+        plane = advanceBlock<false>(slice, plane, steps, !torus, !torus, tileRows, kernel, nullptr, WHOLE, nullptr);
+        g += steps;
+    }
+    return plane;
+}
 
-    // Vector containing information about the slice size and number of generations
-    vector<int> sendInfoVector = {columns, sliceRows, generations};
+/**
+ * @brief Batch mode, simulates many independent boards in one job. Every process reads the manifest and takes whole boards,
+ *        assigned by their estimated cost to the least loaded process (the same on every process, without any message).
+ *        Every process writes the final boards of its entries to their output files, then the root prints the population
+ *        of every board, collected by one MPI_Reduce.
+ * @param size Number of processes.
+ * @param rank Rank of the process.
+ * @param options Options of the program.
+ * @return void
+*/
+void batchLoop(int size, int rank, const Options &options)
+{
+    vector<BatchEntry> entries; // Boards of the batch
+    if (!readManifest(options.batch, options, entries))
+    {
+        if (rank == MASTER) cerr << "Invalid manifest (every line is <board file> <generations> [<rule>] [<output file>])" << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+    }
 
-    // Send the information to all other processes including itself
-    for (int dest = 0; dest < size; dest++) MPI_Send(sendInfoVector.data(), 3, MPI_INT, dest, TAG, MPI_COMM_WORLD);
-    
-    for (int p = 0; p < size; p++) // For each processor (thread)
+    // Longest processing time first: the most expensive boards are assigned first, each to the least loaded process
+    vector<int> order(entries.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return entries[a].cost > entries[b].cost; });
+    vector<double> load(size, 0);
+    vector<long long> population(entries.size(), 0), total(entries.size(), 0); // Living cells of the final boards (-1 on error)
+    for (int i : order)
     {
-        for (int row = 0; row < sliceRows; row++) // For each row in a slice
-        {                         
-            for (int column = 0; column < columns; column++) // For each column in a slice
+        int owner = min_element(load.begin(), load.end()) - load.begin();
+        load[owner] += entries[i].cost;
+        if (owner != rank) continue;
+
+        const BatchEntry &entry = entries[i];
+        vector<vector<Cell>> board; // Rows of the board
+        if (!readBoard(entry.board, board) || !validBoard(board))
+        {
+            population[i] = -1;
+            continue;
+        }
+        Options boardOptions = options;
+        boardOptions.birth = entry.birth;
+        boardOptions.survival = entry.survival;
+        Slice slice;
+        int plane = simulateBoard(board, entry.generations, boardOptions, slice);
+
+        int fd = open(entry.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            population[i] = -1;
+            continue;
+        }
+        {
+            OutputBuffer output(slice.columns, false, fd);
+            for (int x = 0; x < slice.rows; x++)
             {
-                slice[row][column] = board[row + (p * sliceRows)][column]; // Fill the slice with the board values
+                output.row(rank, slice.row(plane, x), slice.columns);
+                for (int y = 0; y < slice.columns; y++) population[i] += slice.row(plane, x)[y];
             }
         }
-        // Slice size = columns * sliceRows;
-        MPI_Send(&slice, columns * sliceRows, MPI_INT, p, 2, MPI_COMM_WORLD); // And send it to all processors
+        close(fd);
     }
 
+    MPI_Reduce(population.data(), total.data(), entries.size(), MPI_LONG_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    if (rank != MASTER) return;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (total[i] < 0) cout << entries[i].board << ": error (board could not be read or written)" << endl;
+        else cout << entries[i].output << ": " << total[i] << " living cells after " << entries[i].generations << " generations" << endl;
+    }
 }
 
 /**
- * @brief Function that processes the generations of the game of life with all processors using the slices of the board.
+ * @brief Counts of the objects found by the census in the ash of the soups of one process.
+ */
+struct Census
+{
+    map<string, long long> objects; // Number of occurrences of every object, by its canonical code
+    long long soups = 0; // Number of simulated soups
+    long long unstable = 0; // Number of soups that did not stabilise within the maximum generations
+};
+
+/**
+ * @brief Returns the hash of the own rows of a plane of the slice (FNV-1a of the cells).
+ * @param slice Slice of the process.
+ * @param plane Plane of the slice.
+ * @return Hash of the board.
+*/
+uint64_t hashBoard(Slice &slice, int plane)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int x = 0; x < slice.rows; x++)
+    {
+        const Cell *row = slice.row(plane, x);
+        for (int y = 0; y < slice.columns; y++) hash = (hash ^ row[y]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Returns the canonical code of an object: its phases over one period in all 8 orientations, each moved
+ *        to the origin, the smallest of them is encoded. The code is `xs<cells>` for a still life or `xp<period>`
+ *        for an oscillator, then the rows of the pattern in hexadecimal (4 cells per digit, lowest bit first), separated by 'z'.
+ * @param phases Living cells (row, column) of the object in its generations, phases[0] is the current one.
+ * @param period Period of the object.
+ * @return Canonical code of the object.
+*/
+string canonicalCode(const vector<vector<pair<int, int>>> &phases, int period)
+{
+    vector<pair<int, int>> best; // Smallest representation
+    for (int phase = 0; phase < period; phase++)
+    {
+        for (int orientation = 0; orientation < 8; orientation++)
+        {
+            vector<pair<int, int>> cells; // Cells of the phase in the orientation
+            for (pair<int, int> cell : phases[phase])
+            {
+                int x = cell.first, y = cell.second;
+                if (orientation & 1) x = -x; // Reflections and the transposition give all 8 symmetries of the square
+                if (orientation & 2) y = -y;
+                if (orientation & 4) swap(x, y);
+                cells.push_back({x, y});
+            }
+            int top = INT_MAX, left = INT_MAX;
+            for (pair<int, int> cell : cells)
+            {
+                top = min(top, cell.first);
+                left = min(left, cell.second);
+            }
+            for (pair<int, int> &cell : cells) cell = {cell.first - top, cell.second - left};
+            sort(cells.begin(), cells.end());
+            if (best.empty() || cells < best) best = cells;
+        }
+    }
+
+    int height = 0, width = 0;
+    for (pair<int, int> cell : best)
+    {
+        height = max(height, cell.first + 1);
+        width = max(width, cell.second + 1);
+    }
+    vector<vector<int>> digits(height, vector<int>((width + 3) / 4, 0)); // Hexadecimal digits of the rows
+    for (pair<int, int> cell : best) digits[cell.first][cell.second / 4] |= 1 << (cell.second % 4);
+
+    string code = period == 1 ? "xs" + to_string(best.size()) + "_" : "xp" + to_string(period) + "_";
+    for (int x = 0; x < height; x++)
+    {
+        if (x > 0) code += 'z';
+        for (int digit : digits[x]) code += "0123456789abcdef"[digit];
+    }
+    return code;
+}
+
+/**
+ * @brief Splits the ash of a stabilised board into objects (8-connected groups of the cells alive in any phase)
+ *        and counts them by their canonical code.
+ * @param phases Boards of one period of the stabilised board (CENSUS_BOARD x CENSUS_BOARD cells each).
+ * @param census Census of the process.
+ * @return void
+*/
+void countObjects(const vector<vector<Cell>> &phases, Census &census)
+{
+    int period = phases.size();
+    vector<Cell> any(CENSUS_BOARD * CENSUS_BOARD, 0); // Cells alive in any phase
+    for (const vector<Cell> &phase : phases) for (size_t i = 0; i < any.size(); i++) any[i] |= phase[i];
+
+    vector<int> component(any.size(), -1); // Object of every cell alive in any phase
+    for (int start = 0; start < CENSUS_BOARD * CENSUS_BOARD; start++)
+    {
+        if (!any[start] || component[start] >= 0) continue;
+        vector<int> cells = {start}; // Cells of the object, searched breadth first
+        component[start] = start;
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            int x = cells[i] / CENSUS_BOARD, y = cells[i] % CENSUS_BOARD;
+            for (int dx = -1; dx <= 1; dx++) for (int dy = -1; dy <= 1; dy++)
+            {
+                int nx = x + dx, ny = y + dy, next = nx * CENSUS_BOARD + ny;
+                if (nx < 0 || ny < 0 || nx >= CENSUS_BOARD || ny >= CENSUS_BOARD || !any[next] || component[next] >= 0) continue;
+                component[next] = start;
+                cells.push_back(next);
+            }
+        }
+
+        vector<vector<pair<int, int>>> objectPhases(period); // Living cells of the object in every phase
+        for (int phase = 0; phase < period; phase++)
+            for (int cell : cells) if (phases[phase][cell]) objectPhases[phase].push_back({cell / CENSUS_BOARD, cell % CENSUS_BOARD});
+        int objectPeriod = 1; // The object may have a shorter period than the whole board
+        while (objectPeriod < period)
+        {
+            vector<pair<int, int>> first = objectPhases[0], later = objectPhases[objectPeriod];
+            sort(first.begin(), first.end());
+            sort(later.begin(), later.end());
+            if (period % objectPeriod == 0 && first == later) break;
+            objectPeriod++;
+        }
+        census.objects[canonicalCode(objectPhases, objectPeriod)]++;
+    }
+}
+
+/**
+ * @brief Simulates one random soup in the centre of a board with walls until it stabilises (the board repeats with
+ *        a period of at most MAX_PERIOD generations, detected by the hashes of the recent boards), then counts its ash.
+ * @param slice Slice for the board (allocated, CENSUS_BOARD x CENSUS_BOARD with one ghost row).
+ * @param index Index of the soup, the soup depends only on the seed and the index.
+ * @param options Options of the program.
+ * @param kernel Kernel computing the rows.
+ * @param census Census of the process.
+ * @return void
+*/
+void runSoup(Slice &slice, long long index, const Options &options, RowKernel kernel, Census &census)
+{
+    fill(slice.cells, slice.cells + slice.size, 0);
+    int offset = (CENSUS_BOARD - SOUP_SIZE) / 2; // Position of the soup on the board
+    for (int x = 0; x < SOUP_SIZE; x++)
+        for (int y = 0; y < SOUP_SIZE; y++)
+            slice.row(0, offset + x)[offset + y] = randomAt(options.soupSeed, (uint64_t)index * SOUP_SIZE * SOUP_SIZE + x * SOUP_SIZE + y) >> 63;
+    census.soups++;
+
+    vector<uint64_t> history(MAX_PERIOD + 1, 0); // Hashes of the recent boards, by the generation modulo MAX_PERIOD + 1
+    history[0] = hashBoard(slice, 0);
+    int plane = 0, period = 0;
+    for (int g = 1; g <= options.generations && period == 0; g++)
+    {
+        plane = advanceBlock<false>(slice, plane, 1, true, true, slice.rows, kernel, nullptr, WHOLE, nullptr);
+        uint64_t hash = hashBoard(slice, plane);
+        for (int p = 1; p <= min(g, MAX_PERIOD) && period == 0; p++) if (history[(g - p) % (MAX_PERIOD + 1)] == hash) period = p;
+        history[g % (MAX_PERIOD + 1)] = hash;
+    }
+    if (period == 0)
+    {
+        census.unstable++;
+        return;
+    }
+
+    vector<vector<Cell>> phases(period, vector<Cell>(CENSUS_BOARD * CENSUS_BOARD)); // Boards of one period
+    for (int phase = 0; phase < period; phase++)
+    {
+        for (int x = 0; x < CENSUS_BOARD; x++) copy(slice.row(plane, x), slice.row(plane, x) + CENSUS_BOARD, &phases[phase][x * CENSUS_BOARD]);
+        plane = advanceBlock<false>(slice, plane, 1, true, true, slice.rows, kernel, nullptr, WHOLE, nullptr);
+    }
+    countObjects(phases, census);
+}
+
+/**
+ * @brief Census mode, simulates random 16x16 soups until they stabilise and counts the still lifes and oscillators
+ *        of their ash. Soup i is simulated by process i modulo the number of processes. The codes of the objects are
+ *        gathered by every process, so the counts are aligned and merged by one MPI_Reduce into the table of the root.
  * @param size Number of processes.
  * @param rank Rank of the process.
+ * @param options Options of the program.
  * @return void
 */
-void generationsLoop(int size, int rank) {
+void censusLoop(int size, int rank, const Options &options)
+{
+    Slice slice; // Board of the soup
+    allocateSlice(slice, CENSUS_BOARD, CENSUS_BOARD, 1, false);
+    RowKernel kernel = selectKernel(options);
+    Census census; // Objects found by this process
+    for (long long index = rank; index < options.soups; index += size) runSoup(slice, index, options, kernel, census);
+
+    // Union of the codes of all processes, every code is terminated by a zero byte
+    string own;
+    for (const auto &object : census.objects) own += object.first + '\0';
+    int length = own.size();
+    vector<int> lengths(size), displacements(size, 0);
+    MPI_Allgather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int i = 1; i < size; i++) displacements[i] = displacements[i - 1] + lengths[i - 1];
+    string all(displacements[size - 1] + lengths[size - 1], '\0');
+    MPI_Allgatherv(own.data(), length, MPI_CHAR, &all[0], lengths.data(), displacements.data(), MPI_CHAR, MPI_COMM_WORLD);
+    map<string, int> codes; // Index of every code in the merged table
+    for (size_t start = 0; start < all.size(); start = all.find('\0', start) + 1) codes[all.c_str() + start] = 0;
+    int next = 0;
+    for (auto &code : codes) code.second = next++;
+
+    // Counts aligned to the codes, followed by the number of soups and of the unstable soups
+    vector<long long> counts(codes.size() + 2, 0), total(counts.size(), 0);
+    for (const auto &object : census.objects) counts[codes[object.first]] = object.second;
+    counts[codes.size()] = census.soups;
+    counts[codes.size() + 1] = census.unstable;
+    MPI_Reduce(counts.data(), total.data(), counts.size(), MPI_LONG_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    if (rank != MASTER) return;
 
-    // Vector containing information about the board size and number of generations
-    vector<int> receiveInfoVector = {0, 0, 0};
+    vector<pair<long long, string>> table; // Objects by their count
+    for (const auto &code : codes) table.push_back({-total[code.second], code.first});
+    sort(table.begin(), table.end());
+    cout << "soups: " << total[codes.size()] << ", not stabilised: " << total[codes.size() + 1] << endl;
+    for (const auto &row : table) cout << -row.first << " " << row.second << endl;
+}
 
-    // Receive the information about the slice size and number of generations
-    MPI_Recv(receiveInfoVector.data(), 3, MPI_INT, MASTER, TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    
-    int columns = receiveInfoVector[COLUMNS];
-    int sliceRows = receiveInfoVector[SLICEROWS];
-    int generations = receiveInfoVector[GENERATIONS];
-    int slice[sliceRows][columns];
-    int tmpSlice[sliceRows][columns]; // Temporary slice will be used to store the new values of cells
+/**
+ * @brief Reads a part of a file at an offset, repeating the read until it is complete.
+ * @param fd File to read.
+ * @param buffer Buffer for the data.
+ * @param size Number of bytes to read.
+ * @param offset Offset of the first byte in the file.
+ * @return True if all bytes were read.
+*/
+bool readFully(int fd, char *buffer, size_t size, off_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t n = pread(fd, buffer, size, offset);
+        if (n <= 0) return false; // Error or the file is shorter
+        buffer += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
 
-    MPI_Recv(&slice, columns * sliceRows, MPI_INT, MASTER, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // Receive the slice from the root process
+/**
+ * @brief Writes a part of a file at an offset, repeating the write until it is complete.
+ * @param fd File to write.
+ * @param buffer Data to write.
+ * @param size Number of bytes to write.
+ * @param offset Offset of the first byte in the file.
+ * @return True if all bytes were written.
+*/
+bool writeFully(int fd, const char *buffer, size_t size, off_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t n = pwrite(fd, buffer, size, offset);
+        if (n <= 0) return false;
+        buffer += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
 
-    vector<int> toBottom(columns), fromTop(columns), toTop(columns), fromBottom(columns); // Vectors for sending/receiving rows to/from other processors
+/**
+ * @brief Band of rows of the streaming mode with the ghost rows on both sides.
+ */
+struct Band
+{
+    int first = 0; // Row of the board with the first own row of the band
+    int rows = 0; // Number of own rows of the band
+    int ghost = 0; // Number of ghost rows on each side (generations of the pass)
+    bool wallTop = false; // The band starts at the top wall of the board
+    bool wallBottom = false; // The band ends at the bottom wall of the board
+};
 
-    for (int g = 1; g <= generations; g++) // For each step (generation) of the game
+/**
+ * @brief Reads the lines of a band and its ghost rows from the board file. On a torus the ghost rows wrap around the file,
+ *        behind a wall they are not read. Consecutive lines are read by one call.
+ * @param fd Board file.
+ * @param band Band to read.
+ * @param rows Number of rows of the board.
+ * @param columns Number of columns of the board.
+ * @param torus True if the board wraps around.
+ * @param buffer Lines of the band from its first ghost row, each of columns + 1 characters.
+ * @return True if all lines were read.
+*/
+bool readBand(int fd, const Band &band, int rows, int columns, bool torus, char *buffer)
+{
+    size_t line = columns + 1; // Characters of a line (cells and the new line)
+    long long from = (long long)band.first - band.ghost, to = (long long)band.first + band.rows + band.ghost; // Lines of the band
+    for (long long x = from; x < to; )
     {
+        long long row = torus ? (x % rows + rows) % rows : x; // Line of the file
+        if (row < 0 || row >= rows) // Behind a wall (ghost rows stay dead)
+        {
+            x = row < 0 ? min(to, 0LL) : to;
+            continue;
+        }
+        long long run = min(to - x, rows - row); // Lines up to the end of the band or of the file
+        if (!readFully(fd, buffer + (x - from) * line, run * line, row * line)) return false;
+        x += run;
+    }
+    return true;
+}
 
-        // Every processor except for the last one will send its last row to the next processor under it
-        if (rank != size - 1) 
+/**
+ * @brief Converts the lines of a band into plane 0 of the slice, ghost rows behind a wall are dead in both planes.
+ * @param slice Slice of the band (rows and first row set).
+ * @param band Band of the lines.
+ * @param buffer Lines of the band from its first ghost row.
+ * @return True if all lines contain only 0s and 1s and end by a new line.
+*/
+bool loadBand(Slice &slice, const Band &band, const char *buffer)
+{
+    size_t line = slice.columns + 1;
+    Cell invalid = 0; // Bits of the cells other than 0 and 1
+    for (int x = -band.ghost; x < band.rows + band.ghost; x++)
+    {
+        if ((x < 0 && band.wallTop) || (x >= band.rows && band.wallBottom))
+        {
+            memset(slice.row(0, x), 0, slice.columns);
+            memset(slice.row(1, x), 0, slice.columns);
+            continue;
+        }
+        const char *chars = buffer + (x + band.ghost) * line;
+        Cell *cells = slice.row(0, x);
+        for (int y = 0; y < slice.columns; y++)
         {
-            for (int j = 0; j < columns; j++) toBottom[j] = slice[sliceRows - 1][j]; // Last row of the slice is sent down to the next processor
-            MPI_Send(toBottom.data(), columns, MPI_INT, rank + 1, 3, MPI_COMM_WORLD);
+            cells[y] = chars[y] - '0';
+            invalid |= cells[y];
         }
-        else fill(fromBottom.begin(), fromBottom.end(), 0); // Last processor has no next processor, so it doesn't send anything
+        if (chars[slice.columns] != '\n') invalid |= 2;
+        slice.wrapColumns(0, x);
+    }
+    return (invalid & ~1) == 0;
+}
 
-        // Every processor except for the first one will receive the last row from the previous processor above it
-        if (rank != 0) MPI_Recv(fromTop.data(), columns, MPI_INT, rank - 1, 3, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // Receive the "toBottom" from the previous processor
-        else fill(fromTop.begin(), fromTop.end(), 0); // First processor has no previous processor, so it doesn't receive anything
+/**
+ * @brief Converts the own rows of the band into lines.
+ * @param slice Slice of the band.
+ * @param plane Plane with the new generation.
+ * @param buffer Lines of the own rows, each of columns + 1 characters.
+ * @return void
+*/
+void storeBand(Slice &slice, int plane, char *buffer)
+{
+    for (int x = 0; x < slice.rows; x++)
+    {
+        const Cell *cells = slice.row(plane, x);
+        char *chars = buffer + (size_t)x * (slice.columns + 1);
+        for (int y = 0; y < slice.columns; y++) chars[y] = '0' + cells[y];
+        chars[slice.columns] = '\n';
+    }
+}
 
-        // Every processor except for the first one will send its first row to the previous processor above it
-        if (rank != 0) 
+/**
+ * @brief Streaming mode for boards larger than the memory: the board stays in its file and bands of rows pass through
+ *        the memory. The file must have lines of the same length, each ended by a new line, so a row is at a known offset.
+ *        Every pass reads the board of one file and writes `depth` generations later into another one, so a band needs no
+ *        messages: its ghost rows are read from the file and the band is advanced like a slice by temporal blocking.
+ *        The bands (at least `depth` rows, the last one takes the remaining rows) are split over the processes in contiguous
+ *        ranges. While a band is computed, a thread reads the next band and writes the previous one (double buffering).
+ *        The passes alternate between the output file and a temporary file next to it, so the last pass writes the output.
+ * @param size Number of processes.
+ * @param rank Rank of the process.
+ * @param options Options of the program.
+ * @return void
+*/
+void streamLoop(int size, int rank, const Options &options)
+{
+    // Dimensions of the board, from the first line and the size of the file (checked by the root)
+    int dimensions[2] = {0, 0};
+    if (rank == MASTER)
+    {
+        ifstream file(options.inputFile, ios::binary);
+        string line;
+        struct stat input, output;
+        if (!file || !getline(file, line) || stat(options.inputFile.c_str(), &input) != 0)
+        {
+            cerr << "Error opening file (Try checking the name of file)" << endl;
+            MPI_Abort(MPI_COMM_WORLD, 1); // Abort the MPI execution environment
+        }
+        if (line.empty() || input.st_size % (line.size() + 1) != 0 || input.st_size / (line.size() + 1) > INT_MAX)
+        {
+            cerr << "Invalid board (rows must have the same length and end by a new line)" << endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (stat(options.stream.c_str(), &output) == 0 && output.st_dev == input.st_dev && output.st_ino == input.st_ino)
         {
-            for (int j = 0; j < columns; j++) toTop[j] = slice[0][j]; // First row of the slice is sent up to the previous processor
-            MPI_Send(toTop.data(), columns, MPI_INT, rank - 1, 4, MPI_COMM_WORLD);
+            cerr << "Output file must differ from the input file" << endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        dimensions[ROWS] = input.st_size / (line.size() + 1);
+        dimensions[COLUMNS] = line.size();
+    }
+    MPI_Bcast(dimensions, 2, MPI_INT, MASTER, MPI_COMM_WORLD);
+    int rows = dimensions[ROWS], columns = dimensions[COLUMNS];
+    size_t line = columns + 1; // Characters of a line
+
+    bool torus = options.topology == TORUS;
+    int depth = options.depth; // Generations of one pass
+    int bandRows = max(depth, options.bandRows > 0 ? options.bandRows : (int)max((size_t)1, BAND_BYTES / line));
+    int bands = max(1, rows / bandRows); // The last band takes the remaining rows
+    int largest = max(min(bandRows, rows), rows - (bands - 1) * bandRows); // Rows of the largest band
+    int firstBand = firstRowOf(rank, size, bands), ownBands = sliceRowsOf(rank, size, bands);
+
+    Slice slice; // Slice of the band being computed
+    if (ownBands > 0) allocateSlice(slice, largest, columns, depth, torus);
+    vector<char> input[2], output[2]; // Lines of the band read next and computed, of the band computed and written previously
+    for (int i = 0; i < 2 && ownBands > 0; i++)
+    {
+        input[i].resize((largest + 2 * (size_t)depth) * line);
+        output[i].resize(largest * line);
+    }
+    RowKernel kernel = selectKernel(options);
+    int tileRows = tileRowsFor(options, columns);
 
-        // Every processor except for the last one will receive the first row from the next processor under it
-        if (rank != size - 1) MPI_Recv(fromBottom.data(), columns, MPI_INT, rank + 1, 4, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // Receive the "toTop" from the next processor
+    // Band i of the process in a pass of the given number of generations
+    auto bandOf = [&](int i, int steps)
+    {
+        Band band;
+        int index = firstBand + i;
+        band.first = index * bandRows;
+        band.rows = index == bands - 1 ? rows - band.first : bandRows;
+        band.ghost = steps;
+        band.wallTop = !torus && band.first == 0;
+        band.wallBottom = !torus && band.first + band.rows == rows;
+        return band;
+    };
 
-        // Calculate the sum of alive neighbors for each cell in the slice
-        int sum = 0; // Sum of alive neighbors
-        for (int x = 0; x < sliceRows; x++) // For each row in the slice
+    int passes = max(1, (options.generations + depth - 1) / depth); // A board of 0 generations is only copied
+    string temporary = options.stream + ".part"; // File of every other pass
+    string source = options.inputFile;
+    for (int pass = 0, g = 0; pass < passes; pass++)
+    {
+        int steps = min(depth, options.generations - g); // Generations of this pass
+        string target = (passes - 1 - pass) % 2 == 0 ? options.stream : temporary;
+        if (rank == MASTER) // The target has its final size before any band is written
         {
-            for (int y = 0; y < columns; y++) // For each column in the slice
+            int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0 || ftruncate(fd, (off_t)rows * line) != 0)
             {
-                sum = 0; // Reset the sum for each cell
-                for (int dx = -1; dx <= 1; dx++) // For each neighbor in the x direction
-                {
-                    for (int dy = -1; dy <= 1; dy++) // For each neighbor in the y direction
-                    {
-                        // Skip the cell itself
-                        if (dx == 0 && dy == 0) continue;
-
-                        // Calculate the coordinates of the neighbor
-                        int nx = x + dx;
-                        int ny = y + dy;
-
-                        // Check if the neighbor is within the bounds of the slice
-                        if (nx >= 0 && nx < sliceRows && ny >= 0 && ny < columns) sum += slice[nx][ny];
-                        // If the neighbor is outside the slice, check the corresponding row from the neighboring slice
-                        // If there is no neighboring slice, the array is filled with zeros, so nothing will be added to the sum
-                        else if (nx < 0) sum += fromTop[ny];
-                        else if (nx >= sliceRows) sum += fromBottom[ny];
-                    }
-                }
-
-                // Apply the rules of the game to each cell using sum, which now contains the number of living neighbors of the cell
-                if (slice[x][y] == 1 && sum < 2) tmpSlice[x][y] = 0; // Live cell with less than 2 living neighbours dies
-                else if (slice[x][y] == 1 && (sum == 2 || sum == 3)) tmpSlice[x][y] = 1; // Live cell with 2 or 3 living neighbours lives
-                else if (slice[x][y] == 1 && sum > 3) tmpSlice[x][y] = 0; // Live cell with more than 3 living neighbours dies
-                else if (slice[x][y] == 0 && sum == 3) tmpSlice[x][y] = 1; // Dead cell with 3 living neighbours lives
-                else tmpSlice[x][y] = 0; // Dead cell with other than 3 living neighbours stays dead
+                cerr << "Error writing file " << target << endl;
+                MPI_Abort(MPI_COMM_WORLD, 1);
             }
+            close(fd);
         }
+        MPI_Barrier(MPI_COMM_WORLD); // The target exists and the source was written completely by the previous pass
 
-        // Once the final generation is reached, print the board
-        if (g == generations)
+        int in = open(source.c_str(), O_RDONLY), out = open(target.c_str(), O_WRONLY);
+        bool transferred = in >= 0 && out >= 0; // All bands were read and written
+        bool valid = true; // All lines of the board are valid
+        if (ownBands > 0 && transferred) transferred = readBand(in, bandOf(0, steps), rows, columns, torus, input[0].data());
+        for (int i = 0; i < ownBands && transferred; i++)
         {
-            // Only the root process will print the board
-            if (rank == 0)
+            // The next band is read and the previous one written while this one is computed
+            bool io = true;
+            thread transfer([&, i]()
             {
-                int sliceToPrint[sliceRows][columns];
-                for (int x = 0; x < sliceRows; x++) // Print the root's slice
-                {
-                    cout << rank << ": ";
-                    for (int y = 0; y < columns; y++) cout << tmpSlice[x][y]; // Print the row of the slice
-                    cout << endl;
-                }
-                for (int i = 1; i < size; i++)
+                if (i + 1 < ownBands) io = readBand(in, bandOf(i + 1, steps), rows, columns, torus, input[(i + 1) % 2].data());
+                if (i > 0)
                 {
-                    MPI_Recv(&sliceToPrint, columns * sliceRows, MPI_INT, i, 5, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // Receive the slice from the other processors
-                    for (int x = 0; x < sliceRows; x++) // Print the slices from the other processors
-                    {
-                        cout << i << ": "; // Print the corresponding rank of the processor
-                        for (int y = 0; y < columns; y++) cout << sliceToPrint[x][y];
-                        cout << endl;
-                    }
+                    Band previous = bandOf(i - 1, steps);
+                    io = writeFully(out, output[(i - 1) % 2].data(), previous.rows * line, (off_t)previous.first * line) && io;
                 }
-            }
-            // As non-root process, send the slice to the root process
-            else MPI_Send(&tmpSlice, columns * sliceRows, MPI_INT, MASTER, 5, MPI_COMM_WORLD);
+            });
+
+            Band band = bandOf(i, steps);
+            slice.rows = band.rows;
+            slice.firstRow = band.first;
+            valid = loadBand(slice, band, input[i % 2].data()) && valid;
+            int plane = steps > 0 ? advanceBlock<false>(slice, 0, steps, band.wallTop, band.wallBottom, tileRows, kernel, nullptr, WHOLE, nullptr) : 0;
+            storeBand(slice, plane, output[i % 2].data());
+
+            transfer.join();
+            transferred = io;
         }
+        if (ownBands > 0 && transferred)
+        {
+            Band last = bandOf(ownBands - 1, steps);
+            transferred = writeFully(out, output[(ownBands - 1) % 2].data(), last.rows * line, (off_t)last.first * line);
+        }
+        if (in >= 0) close(in);
+        if (out >= 0) close(out);
 
-        // Copy temporary slice into original slice
-        for (int x = 0; x < sliceRows; x++)
+        int failed[2] = {!transferred, !valid}, anyFailed[2];
+        MPI_Allreduce(failed, anyFailed, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        if (rank == MASTER && (anyFailed[0] || anyFailed[1]))
         {
-            for (int y = 0; y < columns; y++) 
-            {
-                slice[x][y] = tmpSlice[x][y]; // It will be used in the next generation
-            }
+            if (anyFailed[1]) cerr << "Invalid board (rows must have the same length and contain only 0s and 1s)" << endl;
+            else cerr << "Error reading " << source << " or writing " << target << endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        source = target;
+        g += steps;
+    }
+    if (rank == MASTER && passes > 1) unlink(temporary.c_str());
+}
+
+/**
+ * @brief Parses a list of the sysfs (for example 0-3,8-11) of CPUs or NUMA nodes.
+ * @param list List of numbers and ranges.
+ * @return Numbers of the list.
+*/
+vector<int> parseCpuList(const string &list)
+{
+    vector<int> numbers;
+    const char *next = list.c_str();
+    while (*next >= '0' && *next <= '9')
+    {
+        char *end;
+        int first = strtol(next, &end, 10), last = first;
+        if (*end == '-') last = strtol(end + 1, &end, 10);
+        for (int number = first; number <= last; number++) numbers.push_back(number);
+        next = *end == ',' ? end + 1 : end;
+    }
+    return numbers;
+}
+
+/**
+ * @brief Reads the first line of a file of the sysfs.
+ * @param path Path of the file.
+ * @return First line of the file (empty if the file does not exist).
+*/
+string readSysLine(const string &path)
+{
+    ifstream file(path);
+    string line;
+    getline(file, line);
+    return line;
+}
+
+/**
+ * @brief Binds the process to one CPU of its node. The CPUs usable by the processes of the node (the union of their affinity masks)
+ *        are ordered by NUMA node, socket and core, the first hardware threads of all cores before their siblings, and the processes
+ *        of the node take them in the order of their ranks. Consecutive ranks compute neighbouring slices, so the halo exchange
+ *        runs between adjacent cores sharing a cache. Memory allocated after the binding (the slices) is touched first by its owner
+ *        on the NUMA node of its core, and the progress thread inherits the binding.
+ * @param rank Rank of the process.
+ * @return void
+*/
+void bindProcess(int rank)
+{
+    MPI_Comm nodeComm; // Processes on the same node, in the order of their ranks
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nodeComm);
+    int nodeRank;
+    MPI_Comm_rank(nodeComm, &nodeRank);
+    cpu_set_t own, usable; // CPUs of this process and of all processes of the node
+    CPU_ZERO(&own);
+    sched_getaffinity(0, sizeof(own), &own);
+    MPI_Allreduce(&own, &usable, sizeof(cpu_set_t), MPI_BYTE, MPI_BOR, nodeComm);
+    MPI_Comm_free(&nodeComm);
 
+    vector<int> numaNode(CPU_SETSIZE, 0); // NUMA node of every CPU (0 without NUMA)
+    for (int node : parseCpuList(readSysLine(NODE_DIRECTORY + "online")))
+        for (int cpu : parseCpuList(readSysLine(NODE_DIRECTORY + "node" + to_string(node) + "/cpulist")))
+            if (cpu < CPU_SETSIZE) numaNode[cpu] = node;
+
+    vector<array<int, 5>> order; // Sibling index, NUMA node, socket, core and number of every usable CPU
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &usable)) continue;
+        string topology = CPU_DIRECTORY + "cpu" + to_string(cpu) + "/topology/";
+        vector<int> siblings = parseCpuList(readSysLine(topology + "thread_siblings_list"));
+        int sibling = find(siblings.begin(), siblings.end(), cpu) - siblings.begin(); // Hardware thread of the core (0 if not known)
+        if (sibling == (int)siblings.size()) sibling = 0;
+        int socket = atoi(readSysLine(topology + "physical_package_id").c_str());
+        int core = atoi(readSysLine(topology + "core_id").c_str());
+        order.push_back({sibling, numaNode[cpu], socket, core, cpu});
     }
+    if (order.empty()) return;
+    sort(order.begin(), order.end());
+
+    cpu_set_t chosen; // CPU of this process, processes beyond the number of CPUs start over
+    CPU_ZERO(&chosen);
+    CPU_SET(order[nodeRank % order.size()][4], &chosen);
+    if (sched_setaffinity(0, sizeof(chosen), &chosen) != 0) cerr << "Process " << rank << " could not be bound to a CPU" << endl;
 }
 
 /**
- * @brief Main function that initializes MPI, gets the rank and size of the process and calls the appropriate function for the root, and then the loop for all processes.
+ * @brief Main function that initializes MPI, gets the rank and size of the process, parses the options and calls the loop for all processes.
  * @param argc Number of command-line arguments.
  * @param argv Array of command-line arguments.
  * @return 0
 */
 int main(int argc, char* argv[])
 {
-    MPI_Init(&argc,&argv);
+    int provided; // The progress thread calls MPI while the main thread computes, but never both at the same time
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
     int rank, size;
 
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    if (rank == 0) processRoot(size, rank, argc, argv);
-    generationsLoop(size, rank);
+    Options options = parseOptions(rank, argc, argv);
+    if (options.progress == THREAD && provided < MPI_THREAD_SERIALIZED) options.progress = POLL; // No progress thread without thread support
+    if (options.bind) bindProcess(rank); // Before any slice is allocated, so it is placed on the NUMA node of the core
+    if (!options.batch.empty()) batchLoop(size, rank, options);
+    else if (options.soups > 0) censusLoop(size, rank, options);
+    else if (!options.stream.empty()) streamLoop(size, rank, options);
+    else generationsLoop(size, rank, options);
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}